@@ -1,105 +1,1102 @@
 /* rede_social.c
    Rede de Amizades (grafo não orientado)
-   Representação: Lista de adjacência (com matriz de adjacência atualizada)
-   Limite máximo de vértices: MAX_VERTICES (20 por padrão)
+   Representação: Lista de adjacência
+   Vetor de vértices dinâmico (cresce por duplicação, sem limite fixo);
+   memória O(V + E).
+   Busca por nome: índice hash com endereçamento aberto (O(1) esperado).
+   Nomes guardados numa arena contígua (deslocamento + tamanho + hash).
+   Snapshot CSR imutável (freeze_graph) para percursos somente leitura.
+   Nós de adjacência alocados em blocos (pool) com lista de livres.
+   Vértices de grau alto ganham um conjunto hash de vizinhos: teste e
+   remoção de aresta em O(1) esperado; os demais varrem a lista menor.
+   Espelho opcional em matriz de bits (64 vértices por palavra) para
+   teste de aresta O(1), amigos em comum por popcount e BFS densa.
+   Cada vértice tem um id externo estável; a remoção rápida troca o
+   vértice removido pelo último (custo proporcional aos vizinhos).
+   Graus mantidos a cada inserção/remoção, com índice por faixas de grau
+   (vetor ordenado por grau): mais conectados e histograma sem varrer listas.
+   Inserção de arestas em lote: ordenação radix + deduplicação e listas
+   contíguas alocadas num único bloco.
+   BFS com otimização de direção (top-down / bottom-up) sobre o CSR.
+   BFS paralela síncrona por nível (pthreads); compilar com -pthread -lm.
+   Contexto de percurso reutilizável (marcas por época, fila e pilhas).
+   Consultas: vizinhança de k saltos e menor caminho (BFS bidirecional).
+   Componentes conexas: union-find incremental nas inserções (consulta
+   O(α)); após remoções, recálculo completo por Afforest paralelo no CSR.
+   Amigos em comum (interseção por merge ou galope com AVX2), contagem de
+   triângulos paralela e coeficiente de agrupamento sobre o CSR ordenado.
+   Leitura concorrente estilo RCU: o escritor publica versões imutáveis
+   (blocos de vizinhos compartilhados entre versões, só os vértices
+   alterados são copiados) e leitores fazem BFS/DFS sem trava; versões
+   antigas são liberadas por época quando nenhum leitor as usa.
+   Sugestão de amizades (top-k por amigos em comum ou Adamic-Adar) com
+   heap limitado e rascunho reutilizável, sem alocação por consulta.
+   CSR comprimido opcional (diferenças entre vizinhos ordenados em varint,
+   ~1-2 bytes por meia-aresta) com BFS e amigos em comum decodificando na hora.
+   Snapshot binário (nomes + índice + CSR) carregado por mmap, sem cópia;
+   consultas somente leitura direto sobre o arquivo mapeado:
+     ./rede --query grafo.bin pessoa [outra]
+   Importação em massa de listas de arestas (CSV/TSV) por linha de comando:
+     ./rede --import arestas.csv [snapshot.bin]
+   Exportação em O(V + E) com buffer grande (DOT, arestas, adjacência):
+     ./rede --export dot|edges|tsv|adj arestas.csv [saida|-]
+   Modo de comandos em lote (ADD_EDGE a b, BFS a, ...), sem prompts e com
+   saída em buffer, para repetir milhões de operações:
+     ./rede --batch [comandos.txt|-] [saida|-]
+   Modo durável: log de escrita antecipada (WAL) com commit em grupo sobre
+   o snapshot binário; reinício = mmap do snapshot + reaplicar a cauda do
+   log, com compactação (checkpoint) periódica:
+     ./rede --durable grafo.bin grafo.wal [comandos.txt|-] [saida|-]
+   Instrumentação opcional (compilar com -DREDE_STATS): contadores de
+   arestas varridas, nós, sondagens do índice, fronteiras e tempos.
+   Benchmark com grafos sintéticos (R-MAT, Barabási-Albert, Erdős-Rényi):
+     ./rede --bench rmat|ba|er V E [semente]
+   Reordenação de vértices (grau, ordem de BFS ou Cuthill-McKee reverso)
+   para localidade nos percursos; comparação antes/depois:
+     ./rede --bench-reorder rmat|ba|er V E [semente]
+   Grafo particionado por hash do nome em shards com vértices fantasmas e
+   BFS síncrona por nível trocando fronteiras em lote; corte e mensagens:
+     ./rede --bench-shards rmat|ba|er V E shards [semente]
+   Leitores concorrentes sem trava (versões estilo RCU) contra um escritor
+   que insere, remove e publica; confere cada versão lida:
+     ./rede --bench-rcu rmat|ba|er V E leitores [semente]
 */
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <limits.h>
+#include <math.h>
+#include <float.h>
+#include <time.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/resource.h>
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
 
-#define MAX_VERTICES 20
 #define NAME_LEN 50
+#define MIN_ARENA_CAP 4096  // bytes iniciais da arena de nomes
+#define MIN_VERTEX_CAP 16   // capacidade inicial do vetor de vértices
+#define MIN_INDEX_CAP 32    // capacidade inicial do índice hash (potência de 2)
+#define ADJ_CHUNK_NODES 4096 // nós de adjacência por bloco do pool
+#define HUB_DEGREE 32       // grau a partir do qual o vértice ganha conjunto hash
+#define BFS_DO_ALPHA 14     // top-down -> bottom-up quando m_f > m_u / ALPHA
+#define BFS_DO_BETA 24      // bottom-up -> top-down quando n_f < n / BETA
+#define PAR_BFS_CHUNK 256   // vértices da fronteira pegos por vez por thread
+#define CC_CHUNK 1024       // vértices pegos por vez por thread no Afforest
+#define CC_NEIGHBOR_ROUNDS 2 // rodadas de amostragem de vizinhos no Afforest
+#define CC_SAMPLES 1024     // amostras para achar a maior componente
+#define GALLOP_RATIO 32     // interseção por galope quando |maior| > RATIO * |menor|
+#define TRI_CHUNK 64        // vértices pegos por vez por thread na contagem de triângulos
+#define RECOMMEND_MUTUAL 0       // pontuação = número de amigos em comum
+#define RECOMMEND_ADAMIC_ADAR 1  // pontuação = soma de 1 / log(grau do amigo em comum)
+#define REORDER_DEGREE 0    // reordenação por grau decrescente
+#define REORDER_BFS 1       // ordem de visita da BFS (fontes por grau decrescente)
+#define REORDER_RCM 2       // Cuthill-McKee reverso (vizinhos perto no índice)
+#define RCU_MAX_READERS 64  // leitores registrados ao mesmo tempo
+#define BENCH_SAMPLES 65536 // latências guardadas por operação medida (amostragem uniforme)
+#define BENCH_QUERIES 16    // consultas de percurso por benchmark
 
 /* ----- Estruturas ----- */
 
 typedef struct AdjNode {
     int v;                  // índice do vértice adjacente
+    float w;                // peso da aresta (1 = sem peso); ocupa o alinhamento antes de next
     struct AdjNode *next;
 } AdjNode;
 
+/* Bloco do pool de nós de adjacência */
+typedef struct AdjChunk {
+    struct AdjChunk *next;  // bloco alocado anteriormente
+    int used;               // nós já entregues deste bloco
+    int cap;                // nós no bloco
+    AdjNode nodes[];
+} AdjChunk;
+
+/* Pool de AdjNode: blocos contíguos + lista de nós reciclados */
+typedef struct {
+    AdjChunk *chunks;       // bloco atual (cabeça da lista de blocos)
+    AdjNode *free_list;     // nós liberados, encadeados por next
+} AdjPool;
+
+/* Conjunto hash de vizinhos (endereçamento aberto): vizinho -> nó da lista */
+typedef struct {
+    int v;                  // -1 = slot vazio
+    AdjNode *node;
+} NbrSlot;
+
+typedef struct {
+    NbrSlot *slots;
+    int cap;                // potência de 2
+    int count;
+} NbrSet;
+
 typedef struct {
-    char *name;             // nome do usuário (alocado dinamicamente)
     AdjNode *head;          // cabeça da lista de adjacência
+    NbrSet *hub;            // conjunto de vizinhos (só com grau >= HUB_DEGREE)
+    int degree;             // tamanho da lista
+    uint32_t name_off;      // nome na arena: data + name_off (terminado em \0)
+    uint32_t name_len;      // tamanho do nome sem o \0
+    uint32_t hash;          // hash do nome, calculado uma única vez
+    int id;                 // identificador externo estável (não muda com remoções)
 } Vertex;
 
+/* Arena de nomes: todos os nomes contíguos, cada um terminado em \0 */
+typedef struct {
+    char *data;
+    size_t len, cap;
+    size_t garbage;         // bytes de nomes removidos (recuperados ao compactar)
+} NameArena;
+
+/* Entrada do índice hash de nomes (sondagem linear) */
+typedef struct {
+    uint32_t hash;          // hash do nome (evita strcmp em colisões)
+    int idx;                // índice do vértice, -1 = vazio
+} NameSlot;
+
+typedef struct {
+    NameSlot *slots;
+    int cap;                // sempre potência de 2
+    int count;
+} NameIndex;
+
+/* Union-find dos componentes conexos (indexado pelo índice do vértice) */
+typedef struct {
+    int *parent;            // pai de cada vértice (raiz: parent[i] == i)
+    int *size;              // tamanho da componente (válido só nas raízes)
+    int cap;
+    int count;              // número de componentes
+    int dirty;              // 1 = remoções invalidaram a estrutura (recalcular)
+} UnionFind;
+
+/* Índice de graus: vértices em order[] por grau decrescente; os de grau >= d
+   ocupam order[0..ge[d]). Cada +1/-1 no grau é uma troca de posições, O(1). */
+typedef struct {
+    int *order;             // vértices por grau decrescente
+    int *pos;               // posição de cada vértice em order
+    int *ge;                // ge[d] = vértices com grau >= d (cap + 1 entradas, zeros após max_degree)
+    int cap;
+    int max_degree;
+} DegreeIndex;
+
+/* Matriz de adjacência compactada: linha u tem words palavras de 64 bits */
+typedef struct {
+    uint64_t *bits;         // NULL = espelho desativado
+    int words;              // palavras por linha (dimensão = words * 64)
+} BitMatrix;
+
 typedef struct {
-    Vertex vertices[MAX_VERTICES];
+    Vertex *vertices;       // vetor dinâmico de vértices
     int n;                  // número atual de vértices
-    int adjMatrix[MAX_VERTICES][MAX_VERTICES]; // matriz de adjacência espelho
+    int cap;                // capacidade alocada de vertices
+    NameIndex index;        // índice hash nome -> vértice
+    AdjPool pool;           // alocador dos nós de adjacência
+    BitMatrix bm;           // espelho opcional em bits
+    int *id_to_index;       // id externo -> índice atual (-1 = removido)
+    int id_cap;             // capacidade de id_to_index
+    int next_id;            // próximo id a atribuir
+    NameArena names;        // nomes dos vértices
+    UnionFind uf;           // componentes conexos
+    DegreeIndex deg;        // vértices agrupados por grau
+    int weighted;           // 1 = alguma aresta recebeu peso diferente de 1
 } Graph;
 
 /* ----- Funções utilitárias ----- */
 
 void init_graph(Graph *g) {
+    g->vertices = NULL;
     g->n = 0;
-    for (int i = 0; i < MAX_VERTICES; ++i) {
-        g->vertices[i].name = NULL;
-        g->vertices[i].head = NULL;
-        for (int j = 0; j < MAX_VERTICES; ++j) g->adjMatrix[i][j] = 0;
+    g->cap = 0;
+    g->index.slots = NULL;
+    g->index.cap = 0;
+    g->index.count = 0;
+    g->pool.chunks = NULL;
+    g->pool.free_list = NULL;
+    g->bm.bits = NULL;
+    g->bm.words = 0;
+    g->id_to_index = NULL;
+    g->id_cap = 0;
+    g->next_id = 0;
+    g->names.data = NULL;
+    g->names.len = g->names.cap = g->names.garbage = 0;
+    g->uf.parent = g->uf.size = NULL;
+    g->uf.cap = g->uf.count = g->uf.dirty = 0;
+    g->deg.order = g->deg.pos = g->deg.ge = NULL;
+    g->deg.cap = g->deg.max_degree = 0;
+    g->weighted = 0;
+}
+
+/* Garante capacidade para pelo menos cap vértices (retorna 0 sucesso, -1 sem memória) */
+int graph_reserve(Graph *g, int cap) {
+    if (cap <= g->cap) return 0;
+    Vertex *nv = realloc(g->vertices, sizeof(Vertex) * (size_t)cap);
+    if (!nv) return -1;
+    g->vertices = nv;
+    g->cap = cap;
+    return 0;
+}
+
+/* Reduz a capacidade ao número atual de vértices */
+void graph_shrink_to_fit(Graph *g) {
+    if (g->cap == g->n) return;
+    if (g->n == 0) {
+        free(g->vertices);
+        g->vertices = NULL;
+        g->cap = 0;
+        return;
+    }
+    Vertex *nv = realloc(g->vertices, sizeof(Vertex) * (size_t)g->n);
+    if (nv) {
+        g->vertices = nv;
+        g->cap = g->n;
     }
 }
 
-char *strdup_local(const char *s) {
-    if (!s) return NULL;
-    size_t l = strlen(s) + 1;
-    char *p = malloc(l);
-    if (p) memcpy(p, s, l);
-    return p;
+/* Relógio monotônico em segundos */
+double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
 }
 
-/* Cria um novo nó de adjacência */
-AdjNode *create_adj_node(int v) {
-    AdjNode *node = (AdjNode*) malloc(sizeof(AdjNode));
-    if (!node) {
-        fprintf(stderr, "Erro: sem memória para nó.\n");
-        exit(EXIT_FAILURE);
+/* ----- Instrumentação (opcional, compilar com -DREDE_STATS) ----- */
+
+/* Sem REDE_STATS as macros somem e o custo é zero. Com ela, os contadores
+   são globais e não atômicos: só os caminhos sequenciais são medidos. */
+typedef struct {
+    long long calls;
+    double seconds;
+    double max;
+} StatTimer;
+
+typedef struct {
+    long long edges_scanned;    // nós de adjacência examinados
+    long long nodes_alloc;      // nós entregues pelo pool
+    long long nodes_freed;      // nós devolvidos ao pool
+    long long lookups;          // buscas no índice de nomes
+    long long probes;           // slots examinados nessas buscas
+    long long probe_max;        // maior sequência de sondagem
+    long long frontier_max;     // maior fila da BFS / pilha da DFS
+    long long visited;          // vértices visitados por BFS/DFS
+    StatTimer t_find, t_add_edge, t_remove_vertex, t_bfs, t_dfs;
+} GraphStats;
+
+#ifdef REDE_STATS
+static GraphStats g_stats;
+
+static void stats_timer_add(StatTimer *t, double t0) {
+    double dt = now_seconds() - t0;
+    t->calls++;
+    t->seconds += dt;
+    if (dt > t->max) t->max = dt;
+}
+
+#define STAT_INC(f) (g_stats.f++)
+#define STAT_ADD(f, x) (g_stats.f += (x))
+#define STAT_MAX(f, x) do { if ((long long)(x) > g_stats.f) g_stats.f = (x); } while (0)
+#define STAT_LOOKUP(p) do { g_stats.lookups++; g_stats.probes += (p); STAT_MAX(probe_max, p); } while (0)
+#define STAT_TIMER_START() double stat_t0_ = now_seconds()
+#define STAT_RETURN(t, x) do { stats_timer_add(&g_stats.t, stat_t0_); return (x); } while (0)
+#else
+#define STAT_INC(f) ((void)0)
+#define STAT_ADD(f, x) ((void)0)
+#define STAT_MAX(f, x) ((void)0)
+#define STAT_LOOKUP(p) ((void)0)
+#define STAT_TIMER_START() ((void)0)
+#define STAT_RETURN(t, x) return (x)
+#endif
+
+void stats_reset(void) {
+#ifdef REDE_STATS
+    memset(&g_stats, 0, sizeof(g_stats));
+#endif
+}
+
+static void stats_print_timer(const char *name, const StatTimer *t) {
+    printf(" %-22s %10lld chamadas %10.3f ms total %9.3f us média %9.3f us máx\n", name, t->calls,
+           t->seconds * 1e3, t->calls ? t->seconds / (double)t->calls * 1e6 : 0.0, t->max * 1e6);
+}
+
+/* Relatório dos contadores desde o início ou o último stats_reset() */
+void stats_report(void) {
+#ifdef REDE_STATS
+    const GraphStats *s = &g_stats;
+    printf("Estatísticas:\n");
+    printf(" arestas varridas: %lld\n", s->edges_scanned);
+    printf(" nós alocados: %lld | liberados: %lld | em uso: %lld\n",
+           s->nodes_alloc, s->nodes_freed, s->nodes_alloc - s->nodes_freed);
+    printf(" buscas no índice: %lld | sondagens: %lld (média %.2f, máx %lld)\n", s->lookups, s->probes,
+           s->lookups ? (double)s->probes / (double)s->lookups : 0.0, s->probe_max);
+    printf(" visitados em BFS/DFS: %lld | maior fronteira: %lld\n", s->visited, s->frontier_max);
+    stats_print_timer("find_vertex_index", &s->t_find);
+    stats_print_timer("add_edge_by_index", &s->t_add_edge);
+    stats_print_timer("remove_vertex_by_index", &s->t_remove_vertex);
+    stats_print_timer("bfs", &s->t_bfs);
+    stats_print_timer("dfs", &s->t_dfs);
+#else
+    (void)stats_print_timer;
+    printf("Instrumentação desativada: recompile com -DREDE_STATS.\n");
+#endif
+}
+
+/* ----- Pool de nós de adjacência ----- */
+
+/* Cria um novo nó de adjacência (reaproveita nós livres; senão usa o bloco atual) */
+AdjNode *create_adj_node(AdjPool *p, int v) {
+    AdjNode *node = p->free_list;
+    if (node) {
+        p->free_list = node->next;
+    } else {
+        if (!p->chunks || p->chunks->used == p->chunks->cap) {
+            AdjChunk *c = malloc(sizeof(AdjChunk) + sizeof(AdjNode) * ADJ_CHUNK_NODES);
+            if (!c) {
+                fprintf(stderr, "Erro: sem memória para nó.\n");
+                exit(EXIT_FAILURE);
+            }
+            c->next = p->chunks;
+            c->used = 0;
+            c->cap = ADJ_CHUNK_NODES;
+            p->chunks = c;
+        }
+        node = &p->chunks->nodes[p->chunks->used++];
     }
+    STAT_INC(nodes_alloc);
     node->v = v;
+    node->w = 1.0f;
     node->next = NULL;
     return node;
 }
 
+/* Reserva count nós contíguos (para inserção em lote); NULL se sem memória.
+   Usa o bloco atual se couber; senão um bloco dedicado, mantendo o atual. */
+AdjNode *adj_pool_alloc_block(AdjPool *p, size_t count) {
+    if (count == 0) return NULL;
+    STAT_ADD(nodes_alloc, (long long)count);
+    if (p->chunks && (size_t)(p->chunks->cap - p->chunks->used) >= count) {
+        AdjNode *nodes = &p->chunks->nodes[p->chunks->used];
+        p->chunks->used += (int)count;
+        return nodes;
+    }
+    if (count > INT_MAX) return NULL;
+    AdjChunk *c = malloc(sizeof(AdjChunk) + sizeof(AdjNode) * count);
+    if (!c) return NULL;
+    c->used = c->cap = (int)count;
+    if (p->chunks) {
+        c->next = p->chunks->next;
+        p->chunks->next = c;
+    } else {
+        c->next = NULL;
+        p->chunks = c;
+    }
+    return c->nodes;
+}
+
+/* Devolve um nó ao pool */
+void free_adj_node(AdjPool *p, AdjNode *node) {
+    STAT_INC(nodes_freed);
+    node->next = p->free_list;
+    p->free_list = node;
+}
+
+/* Libera todos os blocos de uma vez (invalida todos os nós) */
+void adj_pool_release(AdjPool *p) {
+    AdjChunk *c = p->chunks;
+    while (c) {
+        AdjChunk *tmp = c;
+        c = c->next;
+        free(tmp);
+    }
+    p->chunks = NULL;
+    p->free_list = NULL;
+}
+
+/* ----- Arena de nomes ----- */
+
+/* Nome do vértice i (ponteiro válido até a próxima inserção ou compactação) */
+static inline const char *vertex_name(const Graph *g, int i) {
+    return g->names.data + g->vertices[i].name_off;
+}
+
+/* Copia s[0..len) + \0 para o fim da arena; *off recebe a posição (0 ou -1 sem memória) */
+static int name_arena_append(NameArena *a, const char *s, size_t len, uint32_t *off) {
+    if (a->len + len + 1 > UINT32_MAX) return -1;
+    if (a->len + len + 1 > a->cap) {
+        size_t ncap = a->cap ? a->cap : MIN_ARENA_CAP;
+        while (ncap < a->len + len + 1) ncap *= 2;
+        char *nd = realloc(a->data, ncap);
+        if (!nd) return -1;
+        a->data = nd;
+        a->cap = ncap;
+    }
+    memcpy(a->data + a->len, s, len);
+    a->data[a->len + len] = '\0';
+    *off = (uint32_t)a->len;
+    a->len += len + 1;
+    return 0;
+}
+
+/* Reescreve a arena com os nomes vivos, na ordem dos vértices */
+static int name_arena_rewrite(Graph *g) {
+    NameArena *a = &g->names;
+    size_t live = a->len - a->garbage;
+    char *nd = malloc(live > 0 ? live : 1);
+    if (!nd) return -1;
+    size_t pos = 0;
+    for (int i = 0; i < g->n; ++i) {
+        Vertex *v = &g->vertices[i];
+        memcpy(nd + pos, a->data + v->name_off, v->name_len + 1);
+        v->name_off = (uint32_t)pos;
+        pos += v->name_len + 1;
+    }
+    free(a->data);
+    a->data = nd;
+    a->len = a->cap = live;
+    a->garbage = 0;
+    return 0;
+}
+
+/* Descarta o espaço dos nomes removidos (retorna 0 sucesso, -1 sem memória) */
+int name_arena_compact(Graph *g) {
+    return g->names.garbage == 0 ? 0 : name_arena_rewrite(g);
+}
+
+/* Marca o nome do vértice i como lixo; compacta quando o lixo passa da metade */
+static void name_arena_release(Graph *g, int i) {
+    NameArena *a = &g->names;
+    a->garbage += g->vertices[i].name_len + 1;
+}
+
+static void name_arena_maybe_compact(Graph *g) {
+    NameArena *a = &g->names;
+    if (a->garbage > MIN_ARENA_CAP && a->garbage * 2 > a->len) name_arena_compact(g);
+}
+
+void name_arena_free(NameArena *a) {
+    free(a->data);
+    a->data = NULL;
+    a->len = a->cap = a->garbage = 0;
+}
+
+/* ----- Índice hash de nomes ----- */
+
+/* Hash FNV-1a de 32 bits */
+uint32_t hash_name(const char *s) {
+    uint32_t h = 2166136261u;
+    while (*s) {
+        h ^= (unsigned char)*s++;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+/* Hash FNV-1a de s[0..len) (igual a hash_name para o mesmo texto) */
+uint32_t hash_name_len(const char *s, size_t len) {
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < len; ++i) {
+        h ^= (unsigned char)s[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+/* Procura o slot do nome s[0..len) com hash h; retorna posição do slot ou -1 */
+static int name_index_find_slot(Graph *g, const char *s, size_t len, uint32_t h) {
+    NameIndex *ix = &g->index;
+    if (ix->cap == 0) return -1;
+    int mask = ix->cap - 1, home = (int)(h & (uint32_t)mask);
+    for (int i = home;; i = (i + 1) & mask) {
+        NameSlot *sl = &ix->slots[i];
+        if (sl->idx == -1) { STAT_LOOKUP(((i - home) & mask) + 1); return -1; }
+        if (sl->hash == h && g->vertices[sl->idx].name_len == len &&
+            memcmp(vertex_name(g, sl->idx), s, len) == 0) { STAT_LOOKUP(((i - home) & mask) + 1); return i; }
+    }
+}
+
+/* Slot ocupado pelo vértice idx (usando o hash guardado no vértice) */
+static int name_index_slot_of(Graph *g, int idx) {
+    Vertex *v = &g->vertices[idx];
+    return name_index_find_slot(g, vertex_name(g, idx), v->name_len, v->hash);
+}
+
+/* Insere sem verificar duplicatas (supõe espaço disponível) */
+static void name_index_place(NameIndex *ix, uint32_t h, int idx) {
+    int mask = ix->cap - 1;
+    int i = (int)(h & (uint32_t)mask);
+    while (ix->slots[i].idx != -1) i = (i + 1) & mask;
+    ix->slots[i].hash = h;
+    ix->slots[i].idx = idx;
+    ix->count++;
+}
+
+/* Redimensiona a tabela para ncap slots (retorna 0 sucesso, -1 sem memória) */
+static int name_index_rehash(NameIndex *ix, int ncap) {
+    NameSlot *old = ix->slots;
+    int ocap = ix->cap;
+    NameSlot *ns = malloc(sizeof(NameSlot) * (size_t)ncap);
+    if (!ns) return -1;
+    for (int i = 0; i < ncap; ++i) ns[i].idx = -1;
+    ix->slots = ns;
+    ix->cap = ncap;
+    ix->count = 0;
+    for (int i = 0; i < ocap; ++i)
+        if (old[i].idx != -1) name_index_place(ix, old[i].hash, old[i].idx);
+    free(old);
+    return 0;
+}
+
+/* Insere nome -> idx, mantendo fator de carga <= 1/2 */
+int name_index_insert(Graph *g, uint32_t h, int idx) {
+    NameIndex *ix = &g->index;
+    if ((ix->count + 1) * 2 > ix->cap) {
+        int ncap = ix->cap ? ix->cap * 2 : MIN_INDEX_CAP;
+        if (name_index_rehash(ix, ncap) != 0) return -1;
+    }
+    name_index_place(ix, h, idx);
+    return 0;
+}
+
+/* Remove o slot i com deslocamento para trás (sem lápides) */
+static void name_index_erase_slot(NameIndex *ix, int i) {
+    int mask = ix->cap - 1;
+    int j = i;
+    while (1) {
+        j = (j + 1) & mask;
+        if (ix->slots[j].idx == -1) break;
+        int k = (int)(ix->slots[j].hash & (uint32_t)mask);
+        // move j para o buraco i se a posição ideal k não estiver em (i, j]
+        int move = (i <= j) ? (k <= i || k > j) : (k <= i && k > j);
+        if (move) {
+            ix->slots[i] = ix->slots[j];
+            i = j;
+        }
+    }
+    ix->slots[i].idx = -1;
+    ix->count--;
+}
+
+/* Remove o nome do vértice idx do índice */
+void name_index_remove(Graph *g, int idx) {
+    int i = name_index_slot_of(g, idx);
+    if (i != -1) name_index_erase_slot(&g->index, i);
+}
+
+/* O vértice em from passará para to: atualiza seu slot */
+static void name_index_reassign(Graph *g, int from, int to) {
+    int i = name_index_slot_of(g, from);
+    if (i != -1) g->index.slots[i].idx = to;
+}
+
+/* Após compactar o vetor de vértices: decrementa índices maiores que target */
+static void name_index_shift_after(Graph *g, int target) {
+    NameIndex *ix = &g->index;
+    for (int i = 0; i < ix->cap; ++i)
+        if (ix->slots[i].idx > target) ix->slots[i].idx--;
+}
+
+void name_index_free(NameIndex *ix) {
+    free(ix->slots);
+    ix->slots = NULL;
+    ix->cap = 0;
+    ix->count = 0;
+}
+
+/* Busca com nome não terminado em \0 (s[0..len)), usada na importação */
+int find_vertex_index_len(Graph *g, const char *s, size_t len) {
+    STAT_TIMER_START();
+    int i = name_index_find_slot(g, s, len, hash_name_len(s, len));
+    STAT_RETURN(t_find, i == -1 ? -1 : g->index.slots[i].idx);
+}
+
 /* Encontra índice do vértice pelo nome; retorna -1 se não encontrado */
 int find_vertex_index(Graph *g, const char *name) {
-    for (int i = 0; i < g->n; ++i) {
-        if (g->vertices[i].name && strcmp(g->vertices[i].name, name) == 0)
-            return i;
+    return find_vertex_index_len(g, name, strlen(name));
+}
+
+/* ----- Matriz de adjacência em bits (espelho opcional) ----- */
+
+/* Contagem de bits de uma palavra */
+static inline int popcount64(uint64_t x) {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_popcountll(x);
+#else
+    x = x - ((x >> 1) & 0x5555555555555555ULL);
+    x = (x & 0x3333333333333333ULL) + ((x >> 2) & 0x3333333333333333ULL);
+    x = (x + (x >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+    return (int)((x * 0x0101010101010101ULL) >> 56);
+#endif
+}
+
+/* Índice do bit menos significativo ligado (x != 0) */
+static inline int ctz64(uint64_t x) {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_ctzll(x);
+#else
+    int n = 0;
+    while (!(x & 1)) { x >>= 1; n++; }
+    return n;
+#endif
+}
+
+/* popcount(a AND b) sobre words palavras; com AVX2 usa tabela de nibbles (Mula) */
+int popcount_and(const uint64_t *a, const uint64_t *b, int words) {
+    int total = 0, w = 0;
+#if defined(__AVX2__)
+    const __m256i lut = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+                                         0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+    const __m256i low = _mm256_set1_epi8(0x0F);
+    __m256i acc = _mm256_setzero_si256();
+    for (; w + 4 <= words; w += 4) {
+        __m256i x = _mm256_and_si256(_mm256_loadu_si256((const __m256i*)(a + w)),
+                                     _mm256_loadu_si256((const __m256i*)(b + w)));
+        __m256i cnt = _mm256_add_epi8(_mm256_shuffle_epi8(lut, _mm256_and_si256(x, low)),
+                                      _mm256_shuffle_epi8(lut, _mm256_and_si256(_mm256_srli_epi16(x, 4), low)));
+        acc = _mm256_add_epi64(acc, _mm256_sad_epu8(cnt, _mm256_setzero_si256()));
     }
-    return -1;
+    uint64_t part[4];
+    _mm256_storeu_si256((__m256i*)part, acc);
+    total = (int)(part[0] + part[1] + part[2] + part[3]);
+#endif
+    for (; w < words; ++w) total += popcount64(a[w] & b[w]);
+    return total;
+}
+
+static inline uint64_t *bm_row(BitMatrix *bm, int u) {
+    return bm->bits + (size_t)u * (size_t)bm->words;
+}
+
+static inline void bm_set(BitMatrix *bm, int u, int v) {
+    bm_row(bm, u)[v >> 6] |= 1ULL << (v & 63);
+}
+
+static inline void bm_clear(BitMatrix *bm, int u, int v) {
+    bm_row(bm, u)[v >> 6] &= ~(1ULL << (v & 63));
+}
+
+static inline int bm_test(BitMatrix *bm, int u, int v) {
+    return (int)((bm_row(bm, u)[v >> 6] >> (v & 63)) & 1);
+}
+
+/* (Re)constrói a matriz a partir das listas para até cap_vertices vértices */
+static int bitmatrix_build(Graph *g, int cap_vertices) {
+    int words = (cap_vertices + 63) / 64;
+    if (words == 0) words = 1;
+    uint64_t *bits = calloc((size_t)words * 64 * (size_t)words, sizeof(uint64_t));
+    if (!bits) return -1;
+    free(g->bm.bits);
+    g->bm.bits = bits;
+    g->bm.words = words;
+    for (int u = 0; u < g->n; ++u)
+        for (AdjNode *curr = g->vertices[u].head; curr; curr = curr->next)
+            bm_set(&g->bm, u, curr->v);
+    return 0;
+}
+
+/* Ativa o espelho em bits (n^2/8 bytes); retorna 0 sucesso, -1 sem memória */
+int graph_enable_bitmatrix(Graph *g) {
+    return bitmatrix_build(g, g->n > 64 ? g->n : 64);
+}
+
+void graph_disable_bitmatrix(Graph *g) {
+    free(g->bm.bits);
+    g->bm.bits = NULL;
+    g->bm.words = 0;
+}
+
+/* Garante espaço para o vértice de índice n-1 (dobra a dimensão se preciso) */
+static int bitmatrix_ensure(Graph *g, int n) {
+    if (!g->bm.bits || n <= g->bm.words * 64) return 0;
+    return bitmatrix_build(g, g->bm.words * 64 * 2);
+}
+
+/* Número de amigos em comum entre u e v (requer o espelho em bits) */
+int bitmatrix_common_count(Graph *g, int u, int v) {
+    if (!g->bm.bits || u < 0 || v < 0 || u >= g->n || v >= g->n) return -1;
+    return popcount_and(bm_row(&g->bm, u), bm_row(&g->bm, v), g->bm.words);
+}
+
+/* BFS densa sobre a matriz: a fronteira seguinte é o OU das linhas da fronteira
+   atual, filtrado pelos não visitados (paralelismo de palavra).
+   Ordem de visita: nível a nível, índices crescentes dentro do nível.
+   level (opcional, n posições) recebe a distância ou -1. Retorna visitados. */
+int bitmatrix_bfs(Graph *g, int start, int *visited_order, int max_out, int *level) {
+    if (!g->bm.bits || start < 0 || start >= g->n) return 0;
+    int words = g->bm.words;
+    uint64_t *visited = calloc((size_t)words * 3, sizeof(uint64_t));
+    if (!visited) return 0;
+    uint64_t *frontier = visited + words, *next = frontier + words;
+    if (level) for (int i = 0; i < g->n; ++i) level[i] = -1;
+    visited[start >> 6] |= 1ULL << (start & 63);
+    frontier[start >> 6] |= 1ULL << (start & 63);
+    int count = 0, depth = 0, active = 1;
+    while (active) {
+        // registra a fronteira atual e expande suas linhas
+        memset(next, 0, sizeof(uint64_t) * (size_t)words);
+        for (int w = 0; w < words; ++w) {
+            uint64_t bitsw = frontier[w];
+            while (bitsw) {
+                int u = w * 64 + ctz64(bitsw);
+                bitsw &= bitsw - 1;
+                if (count < max_out) visited_order[count] = u;
+                count++;
+                if (level) level[u] = depth;
+                const uint64_t *row = bm_row(&g->bm, u);
+                for (int k = 0; k < words; ++k) next[k] |= row[k];
+            }
+        }
+        active = 0;
+        for (int w = 0; w < words; ++w) {
+            next[w] &= ~visited[w];
+            visited[w] |= next[w];
+            active |= next[w] != 0;
+        }
+        uint64_t *tmp = frontier; frontier = next; next = tmp;
+        depth++;
+    }
+    free(visited);
+    return count;
+}
+
+/* ----- Conjunto de vizinhos dos vértices de grau alto ----- */
+
+static inline uint32_t nbr_hash(int v) {
+    uint32_t h = (uint32_t)v * 0x9E3779B1u;
+    return h ^ (h >> 16);
+}
+
+/* Slot do vizinho v; -1 se ausente */
+static int nbrset_find(const NbrSet *set, int v) {
+    int mask = set->cap - 1;
+    for (int i = (int)(nbr_hash(v) & (uint32_t)mask);; i = (i + 1) & mask) {
+        if (set->slots[i].v == v) return i;
+        if (set->slots[i].v == -1) return -1;
+    }
+}
+
+static void nbrset_place(NbrSlot *slots, int cap, int v, AdjNode *node) {
+    int mask = cap - 1;
+    int i = (int)(nbr_hash(v) & (uint32_t)mask);
+    while (slots[i].v != -1) i = (i + 1) & mask;
+    slots[i].v = v;
+    slots[i].node = node;
+}
+
+static int nbrset_rehash(NbrSet *set, int ncap) {
+    NbrSlot *ns = malloc(sizeof(NbrSlot) * (size_t)ncap);
+    if (!ns) return -1;
+    for (int i = 0; i < ncap; ++i) ns[i].v = -1;
+    for (int i = 0; i < set->cap; ++i)
+        if (set->slots[i].v != -1) nbrset_place(ns, ncap, set->slots[i].v, set->slots[i].node);
+    free(set->slots);
+    set->slots = ns;
+    set->cap = ncap;
+    return 0;
+}
+
+/* Insere v (ocupação máxima 1/2); retorna 0 sucesso, -1 sem memória */
+static int nbrset_insert(NbrSet *set, int v, AdjNode *node) {
+    if ((set->count + 1) * 2 > set->cap && nbrset_rehash(set, set->cap * 2) != 0) return -1;
+    nbrset_place(set->slots, set->cap, v, node);
+    set->count++;
+    return 0;
+}
+
+/* Apaga o slot i com deslocamento para trás (sem lápides), como no índice de nomes */
+static void nbrset_erase_slot(NbrSet *set, int i) {
+    int mask = set->cap - 1;
+    int j = i;
+    while (1) {
+        j = (j + 1) & mask;
+        if (set->slots[j].v == -1) break;
+        int k = (int)(nbr_hash(set->slots[j].v) & (uint32_t)mask);
+        int move = (i <= j) ? (k <= i || k > j) : (k <= i && k > j);
+        if (move) {
+            set->slots[i] = set->slots[j];
+            i = j;
+        }
+    }
+    set->slots[i].v = -1;
+    set->count--;
+}
+
+static void hub_drop(Vertex *x) {
+    if (!x->hub) return;
+    free(x->hub->slots);
+    free(x->hub);
+    x->hub = NULL;
+}
+
+/* (Re)constrói o conjunto a partir da lista; sem memória o vértice fica só
+   com a lista (mais lento, mas correto) */
+static void hub_build(Vertex *x) {
+    hub_drop(x);
+    NbrSet *set = malloc(sizeof(NbrSet));
+    if (!set) return;
+    int cap = 16;
+    while (cap < 2 * x->degree) cap *= 2;
+    set->slots = NULL;
+    set->cap = 0;
+    set->count = 0;
+    if (nbrset_rehash(set, cap) != 0) { free(set); return; }
+    for (AdjNode *curr = x->head; curr; curr = curr->next) {
+        nbrset_place(set->slots, set->cap, curr->v, curr);
+        set->count++;
+    }
+    x->hub = set;
+}
+
+/* Registra um nó recém-encadeado na lista de x (grau já atualizado) */
+static void hub_note_insert(Vertex *x, AdjNode *node) {
+    if (x->hub) {
+        if (nbrset_insert(x->hub, node->v, node) != 0) hub_drop(x);
+    } else if (x->degree >= HUB_DEGREE) {
+        hub_build(x);
+    }
+}
+
+/* ----- Union-find (componentes conexos) ----- */
+
+/* Garante espaço para cap vértices (retorna 0 sucesso, -1 sem memória) */
+static int uf_reserve(UnionFind *uf, int cap) {
+    if (cap <= uf->cap) return 0;
+    int ncap = uf->cap ? uf->cap : MIN_VERTEX_CAP;
+    while (ncap < cap) ncap *= 2;
+    int *np = realloc(uf->parent, sizeof(int) * (size_t)ncap);
+    if (!np) return -1;
+    uf->parent = np;
+    int *ns = realloc(uf->size, sizeof(int) * (size_t)ncap);
+    if (!ns) return -1;
+    uf->size = ns;
+    uf->cap = ncap;
+    return 0;
+}
+
+/* Raiz de u com compressão por divisão pela metade (path halving) */
+static int uf_find(UnionFind *uf, int u) {
+    while (uf->parent[u] != u) {
+        uf->parent[u] = uf->parent[uf->parent[u]];
+        u = uf->parent[u];
+    }
+    return u;
+}
+
+/* Une as componentes de u e v (união por tamanho) */
+static void uf_union(UnionFind *uf, int u, int v) {
+    int a = uf_find(uf, u), b = uf_find(uf, v);
+    if (a == b) return;
+    if (uf->size[a] < uf->size[b]) { int t = a; a = b; b = t; }
+    uf->parent[b] = a;
+    uf->size[a] += uf->size[b];
+    uf->count--;
+}
+
+void uf_free(UnionFind *uf) {
+    free(uf->parent);
+    free(uf->size);
+    uf->parent = uf->size = NULL;
+    uf->cap = uf->count = uf->dirty = 0;
+}
+
+/* ----- Índice de graus (grau em O(1), top-k e histograma sem varrer listas) ----- */
+
+/* Garante espaço para cap vértices; grau nunca passa de cap - 1, então ge
+   não cresce nas operações de aresta (retorna 0 sucesso, -1 sem memória) */
+static int deg_reserve(DegreeIndex *di, int cap) {
+    if (cap <= di->cap) return 0;
+    int ncap = di->cap ? di->cap : MIN_VERTEX_CAP;
+    while (ncap < cap) ncap *= 2;
+    int *no = realloc(di->order, sizeof(int) * (size_t)ncap);
+    if (!no) return -1;
+    di->order = no;
+    int *np = realloc(di->pos, sizeof(int) * (size_t)ncap);
+    if (!np) return -1;
+    di->pos = np;
+    int *nge = realloc(di->ge, sizeof(int) * ((size_t)ncap + 1));
+    if (!nge) return -1;
+    memset(nge + (di->ge ? di->cap + 1 : 0), 0, sizeof(int) * (size_t)(ncap - (di->ge ? di->cap : -1)));
+    di->ge = nge;
+    di->cap = ncap;
+    return 0;
+}
+
+static inline void deg_swap(DegreeIndex *di, int i, int j) {
+    int a = di->order[i], b = di->order[j];
+    di->order[i] = b; di->pos[b] = i;
+    di->order[j] = a; di->pos[a] = j;
+}
+
+/* Novo vértice v (grau 0) entra no fim: a faixa de grau 0 é a última */
+static void deg_push(DegreeIndex *di, int v) {
+    di->order[di->ge[0]] = v;
+    di->pos[v] = di->ge[0]++;
+}
+
+/* Grau de v passa de d para d + 1: v troca com o primeiro da faixa d */
+static inline void deg_inc(DegreeIndex *di, int v, int d) {
+    deg_swap(di, di->pos[v], di->ge[d + 1]);
+    di->ge[d + 1]++;
+    if (d + 1 > di->max_degree) di->max_degree = d + 1;
+}
+
+/* Grau de v passa de d para d - 1: v troca com o último da faixa d */
+static inline void deg_dec(DegreeIndex *di, int v, int d) {
+    deg_swap(di, di->pos[v], di->ge[d] - 1);
+    di->ge[d]--;
+    if (d == di->max_degree && di->ge[d] == 0) di->max_degree--;
+}
+
+/* Retira v (grau d) do índice, O(d); a posição final pode ser reaproveitada */
+static void deg_pop(DegreeIndex *di, int v, int d) {
+    for (; d > 0; --d) deg_dec(di, v, d);
+    deg_swap(di, di->pos[v], di->ge[0] - 1);
+    di->ge[0]--;
+}
+
+void deg_free(DegreeIndex *di) {
+    free(di->order);
+    free(di->pos);
+    free(di->ge);
+    di->order = di->pos = di->ge = NULL;
+    di->cap = di->max_degree = 0;
+}
+
+/* Grau do vértice no índice u, O(1) (-1 se índice inválido) */
+int vertex_degree(Graph *g, int u) {
+    if (u < 0 || u >= g->n) return -1;
+    return g->vertices[u].degree;
+}
+
+/* Maior grau do grafo, O(1) */
+int max_degree(Graph *g) {
+    return g->deg.max_degree;
+}
+
+/* Os k vértices de maior grau em out (grau decrescente; empates em ordem
+   arbitrária). O(k): é só o início de order. Retorna quantos foram escritos. */
+int top_degree(Graph *g, int k, int *out) {
+    if (k > g->n) k = g->n;
+    if (k <= 0) return 0;
+    memcpy(out, g->deg.order, sizeof(int) * (size_t)k);
+    return k;
+}
+
+/* Número de vértices com grau exatamente d, O(1) */
+int degree_count(Graph *g, int d) {
+    if (d < 0 || d > g->deg.max_degree) return 0;
+    return g->deg.ge[d] - g->deg.ge[d + 1];
+}
+
+/* hist[d] = vértices com grau d, para d < max_out; O(max_degree).
+   Retorna max_degree + 1 (tamanho do histograma completo). */
+int degree_histogram(Graph *g, int *hist, int max_out) {
+    int len = g->deg.max_degree + 1;
+    for (int d = 0; d < len && d < max_out; ++d) hist[d] = degree_count(g, d);
+    return len;
 }
 
 /* ----- Operações no grafo ----- */
 
-/* Adiciona vértice com nome (retorna 0 sucesso, -1 se cheio, -2 se já existe) */
-int add_vertex(Graph *g, const char *name) {
-    if (g->n >= MAX_VERTICES) return -1;
-    if (find_vertex_index(g, name) != -1) return -2;
-    g->vertices[g->n].name = strdup_local(name);
-    g->vertices[g->n].head = NULL;
-    // adjMatrix já inicializada; linha/coluna correspondentes já zero
+/* Verifica se existe aresta entre os índices u e v
+   (O(1) pelo espelho em bits, senão percorre a lista de u) */
+int has_edge_by_index(Graph *g, int u, int v) {
+    if (g->bm.bits) return bm_test(&g->bm, u, v);
+    Vertex *a = &g->vertices[u], *b = &g->vertices[v];
+    if (a->hub) return nbrset_find(a->hub, v) != -1;
+    if (b->hub) return nbrset_find(b->hub, u) != -1;
+    // sem conjunto: varre a lista do vértice de menor grau
+    if (b->degree < a->degree) { a = b; v = u; }
+    for (AdjNode *curr = a->head; curr; curr = curr->next) {
+        STAT_INC(edges_scanned);
+        if (curr->v == v) return 1;
+    }
+    return 0;
+}
+
+/* Adiciona vértice com nome s[0..len) de hash h (retorna 0 sucesso, -1 sem memória, -2 se já existe) */
+static int add_vertex_hashed(Graph *g, const char *s, size_t len, uint32_t h) {
+    if (name_index_find_slot(g, s, len, h) != -1) return -2;
+    if (g->n == g->cap) {
+        // crescimento por duplicação: custo amortizado O(1) por inserção
+        int ncap = g->cap ? g->cap * 2 : MIN_VERTEX_CAP;
+        if (graph_reserve(g, ncap) != 0) return -1;
+    }
+    if (bitmatrix_ensure(g, g->n + 1) != 0) return -1;
+    if (uf_reserve(&g->uf, g->n + 1) != 0) return -1;
+    if (deg_reserve(&g->deg, g->n + 1) != 0) return -1;
+    if (g->next_id == g->id_cap) {
+        int ncap = g->id_cap ? g->id_cap * 2 : MIN_VERTEX_CAP;
+        int *nm = realloc(g->id_to_index, sizeof(int) * (size_t)ncap);
+        if (!nm) return -1;
+        g->id_to_index = nm;
+        g->id_cap = ncap;
+    }
+    Vertex *vx = &g->vertices[g->n];
+    if (name_arena_append(&g->names, s, len, &vx->name_off) != 0) return -1;
+    vx->name_len = (uint32_t)len;
+    vx->hash = h;
+    vx->head = NULL;
+    vx->hub = NULL;
+    vx->degree = 0;
+    if (name_index_insert(g, h, g->n) != 0) {
+        g->names.len -= len + 1; // desfaz a cópia do nome
+        return -1;
+    }
+    vx->id = g->next_id;
+    g->id_to_index[g->next_id++] = g->n;
+    g->uf.parent[g->n] = g->n; // nova componente unitária
+    g->uf.size[g->n] = 1;
+    g->uf.count++;
+    deg_push(&g->deg, g->n);
     g->n++;
     return 0;
 }
 
+/* Adiciona vértice com nome s[0..len) (não precisa terminar em \0) */
+int add_vertex_len(Graph *g, const char *s, size_t len) {
+    return add_vertex_hashed(g, s, len, hash_name_len(s, len));
+}
+
+/* Adiciona vértice com nome (retorna 0 sucesso, -1 sem memória, -2 se já existe) */
+int add_vertex(Graph *g, const char *name) {
+    return add_vertex_len(g, name, strlen(name));
+}
+
 /* Adiciona aresta não orientada entre índices u e v (retorna 0 sucesso, -1 erro) */
 int add_edge_by_index(Graph *g, int u, int v) {
-    if (u < 0 || u >= g->n || v < 0 || v >= g->n) return -1;
-    if (u == v) return -1; // sem loop
-    if (g->adjMatrix[u][v]) return -1; // já existe
+    STAT_TIMER_START();
+    if (u < 0 || u >= g->n || v < 0 || v >= g->n) STAT_RETURN(t_add_edge, -1);
+    if (u == v) STAT_RETURN(t_add_edge, -1); // sem loop
+    if (has_edge_by_index(g, u, v)) STAT_RETURN(t_add_edge, -1); // já existe
 
     // inserir no início da lista (u -> v)
-    AdjNode *n1 = create_adj_node(v);
-    n1->next = g->vertices[u].head;
-    g->vertices[u].head = n1;
+    Vertex *a = &g->vertices[u], *b = &g->vertices[v];
+    AdjNode *n1 = create_adj_node(&g->pool, v);
+    n1->next = a->head;
+    a->head = n1;
+    deg_inc(&g->deg, u, a->degree++);
+    hub_note_insert(a, n1);
 
     // (v -> u)
-    AdjNode *n2 = create_adj_node(u);
-    n2->next = g->vertices[v].head;
-    g->vertices[v].head = n2;
+    AdjNode *n2 = create_adj_node(&g->pool, u);
+    n2->next = b->head;
+    b->head = n2;
+    deg_inc(&g->deg, v, b->degree++);
+    hub_note_insert(b, n2);
 
-    g->adjMatrix[u][v] = g->adjMatrix[v][u] = 1;
-    return 0;
+    if (g->bm.bits) {
+        bm_set(&g->bm, u, v);
+        bm_set(&g->bm, v, u);
+    }
+    if (!g->uf.dirty) uf_union(&g->uf, u, v);
+    STAT_RETURN(t_add_edge, 0);
 }
 
 /* Inserir aresta por nomes */
@@ -110,55 +1107,56 @@ int add_edge(Graph *g, const char *name1, const char *name2) {
     return add_edge_by_index(g, u, v);
 }
 
-/* Remove ocorrência target da lista do vertice idx (libera memória de nodes removidos) */
-void remove_occurrences_from_list(Vertex *vert, int target) {
-    AdjNode *curr = vert->head;
-    AdjNode *prev = NULL;
-    while (curr) {
-        if (curr->v == target) {
-            AdjNode *tmp = curr;
-            if (prev) prev->next = curr->next;
-            else vert->head = curr->next;
-            curr = curr->next;
-            free(tmp);
-        } else {
+/* Retira target da lista do vértice u e devolve o nó ao pool (0 sucesso, -1 se não existe).
+   Com conjunto hash é O(1): o conteúdo da cabeça passa para o nó removido e a
+   cabeça sai da lista (a ordem da lista muda); sem conjunto, varre a lista. */
+static int adj_unlink(Graph *g, int u, int target) {
+    Vertex *x = &g->vertices[u];
+    AdjNode *curr;
+    if (x->hub) {
+        int i = nbrset_find(x->hub, target);
+        if (i == -1) return -1;
+        curr = x->hub->slots[i].node;
+        nbrset_erase_slot(x->hub, i);
+        AdjNode *head = x->head;
+        if (curr != head) {
+            AdjNode *next = curr->next;
+            *curr = *head;
+            curr->next = next;
+            x->hub->slots[nbrset_find(x->hub, curr->v)].node = curr;
+        }
+        x->head = head->next;
+        curr = head;
+    } else {
+        AdjNode *prev = NULL;
+        for (curr = x->head; curr && curr->v != target; curr = curr->next) {
+            STAT_INC(edges_scanned);
             prev = curr;
-            curr = curr->next;
         }
+        if (!curr) return -1;
+        if (prev) prev->next = curr->next;
+        else x->head = curr->next;
     }
+    free_adj_node(&g->pool, curr);
+    deg_dec(&g->deg, u, x->degree--);
+    if (x->hub && x->degree < HUB_DEGREE / 2) hub_drop(x); // histerese
+    return 0;
 }
 
 /* Remove aresta por índices (não atualiza índices dos vértices) */
 int remove_edge_by_index(Graph *g, int u, int v) {
     if (u < 0 || v < 0 || u >= g->n || v >= g->n) return -1;
-    if (!g->adjMatrix[u][v]) return -1; // não existe
+    if (g->bm.bits && !bm_test(&g->bm, u, v)) return -1; // não existe
 
-    // remover v da lista de u
-    AdjNode *curr = g->vertices[u].head;
-    AdjNode *prev = NULL;
-    while (curr) {
-        if (curr->v == v) {
-            if (prev) prev->next = curr->next;
-            else g->vertices[u].head = curr->next;
-            free(curr);
-            break;
-        }
-        prev = curr; curr = curr->next;
-    }
+    // remover v da lista de u e u da lista de v
+    if (adj_unlink(g, u, v) != 0) return -1; // não existe
+    g->uf.dirty = 1; // a aresta pode ter sido uma ponte
+    adj_unlink(g, v, u);
 
-    // remover u da lista de v
-    curr = g->vertices[v].head; prev = NULL;
-    while (curr) {
-        if (curr->v == u) {
-            if (prev) prev->next = curr->next;
-            else g->vertices[v].head = curr->next;
-            free(curr);
-            break;
-        }
-        prev = curr; curr = curr->next;
+    if (g->bm.bits) {
+        bm_clear(&g->bm, u, v);
+        bm_clear(&g->bm, v, u);
     }
-
-    g->adjMatrix[u][v] = g->adjMatrix[v][u] = 0;
     return 0;
 }
 
@@ -170,68 +1168,114 @@ int remove_edge(Graph *g, const char *name1, const char *name2) {
     return remove_edge_by_index(g, u, v);
 }
 
-/* Libera toda a lista de adjacência de um vértice */
-void free_adj_list(AdjNode *head) {
-    AdjNode *curr = head;
-    while (curr) {
-        AdjNode *tmp = curr;
-        curr = curr->next;
-        free(tmp);
+/* Nó de v na lista de u (pelo conjunto hash, se houver); NULL se não existe */
+static AdjNode *adj_find(Graph *g, int u, int v) {
+    Vertex *x = &g->vertices[u];
+    if (x->hub) {
+        int i = nbrset_find(x->hub, v);
+        return i == -1 ? NULL : x->hub->slots[i].node;
     }
+    for (AdjNode *curr = x->head; curr; curr = curr->next) {
+        STAT_INC(edges_scanned);
+        if (curr->v == v) return curr;
+    }
+    return NULL;
 }
 
-/* Remove vértice no índice target (compacta o vetor de vértices e ajusta índices) */
-int remove_vertex_by_index(Graph *g, int target) {
-    if (target < 0 || target >= g->n) return -1;
+/* Define o peso (força da interação) da aresta u-v nos dois sentidos.
+   O peso precisa ser finito e >= 0 (caminhos por Dijkstra); arestas novas
+   nascem com peso 1. Retorna 0 sucesso, -1 se a aresta não existe ou peso inválido. */
+int set_edge_weight_by_index(Graph *g, int u, int v, float w) {
+    if (u < 0 || v < 0 || u >= g->n || v >= g->n) return -1;
+    if (!(w >= 0.0f) || w > FLT_MAX) return -1; // NaN, negativo ou infinito
+    if (g->bm.bits && !bm_test(&g->bm, u, v)) return -1;
+    AdjNode *a = adj_find(g, u, v);
+    if (!a) return -1;
+    a->w = w;
+    adj_find(g, v, u)->w = w;
+    if (w != 1.0f) g->weighted = 1;
+    return 0;
+}
 
-    // 1) Remover todas as ocorrências de target nas listas dos outros vértices
-    for (int i = 0; i < g->n; ++i) {
-        if (i == target) continue;
-        remove_occurrences_from_list(&g->vertices[i], target);
-    }
+int set_edge_weight(Graph *g, const char *name1, const char *name2, float w) {
+    int u = find_vertex_index(g, name1);
+    int v = find_vertex_index(g, name2);
+    if (u == -1 || v == -1) return -1;
+    return set_edge_weight_by_index(g, u, v, w);
+}
 
-    // 2) Liberar a lista do próprio vértice e o nome
-    free_adj_list(g->vertices[target].head);
-    free(g->vertices[target].name);
-    g->vertices[target].head = NULL;
-    g->vertices[target].name = NULL;
+/* Peso da aresta u-v; -1 se não existe */
+float edge_weight(Graph *g, int u, int v) {
+    if (u < 0 || v < 0 || u >= g->n || v >= g->n) return -1.0f;
+    AdjNode *a = adj_find(g, u, v);
+    return a ? a->w : -1.0f;
+}
 
-    // 3) Shift (compactar) vertices à esquerda
-    for (int i = target; i < g->n - 1; ++i) {
-        g->vertices[i] = g->vertices[i + 1];
-    }
-    // Limpar última posição agora duplicada
-    g->vertices[g->n - 1].head = NULL;
-    g->vertices[g->n - 1].name = NULL;
+/* Devolve toda a lista de adjacência de um vértice ao pool */
+void free_adj_list(AdjPool *p, AdjNode *head) {
+    if (!head) return;
+    AdjNode *tail = head;
+    STAT_INC(nodes_freed);
+    while (tail->next) { tail = tail->next; STAT_INC(nodes_freed); }
+    tail->next = p->free_list;
+    p->free_list = head;
+}
+
+/* Libera lista e conjunto de vizinhos do vértice i */
+static void vertex_release_adj(Graph *g, int i) {
+    Vertex *x = &g->vertices[i];
+    free_adj_list(&g->pool, x->head);
+    hub_drop(x);
+    x->head = NULL;
+    x->degree = 0;
+}
+
+/* Remove vértice no índice target (compacta o vetor de vértices e ajusta índices) */
+int remove_vertex_by_index(Graph *g, int target) {
+    STAT_TIMER_START();
+    if (target < 0 || target >= g->n) STAT_RETURN(t_remove_vertex, -1);
+    g->uf.dirty = 1; // índices mudam e a componente pode se partir
 
-    // 4) Atualizar matriz de adjacência: shift linhas/colunas
+    // 1) Remover target das listas dos seus vizinhos (arestas são simétricas)
+    for (AdjNode *curr = g->vertices[target].head; curr; curr = curr->next)
+        adj_unlink(g, curr->v, target);
+
+    // 2) Retirar do índice e liberar a lista do próprio vértice e o nome
+    name_index_remove(g, target);
+    g->id_to_index[g->vertices[target].id] = -1;
+    deg_pop(&g->deg, target, g->vertices[target].degree);
+    vertex_release_adj(g, target);
+    name_arena_release(g, target);
+
+    // 3) Shift (compactar) vertices à esquerda
     for (int i = target; i < g->n - 1; ++i) {
-        for (int j = 0; j < g->n; ++j) {
-            g->adjMatrix[i][j] = g->adjMatrix[i + 1][j];
-        }
-    }
-    for (int j = target; j < g->n - 1; ++j) {
-        for (int i = 0; i < g->n - 1; ++i) {
-            g->adjMatrix[i][j] = g->adjMatrix[i][j + 1];
-        }
-    }
-    // limpar última linha/coluna
-    for (int i = 0; i < g->n; ++i) {
-        g->adjMatrix[g->n - 1][i] = 0;
-        g->adjMatrix[i][g->n - 1] = 0;
+        g->vertices[i] = g->vertices[i + 1];
+        g->id_to_index[g->vertices[i].id] = i;
     }
+    // Limpar última posição agora duplicada
+    g->vertices[g->n - 1].head = NULL;
+    g->vertices[g->n - 1].hub = NULL;
 
-    // 5) Ajustar índices nos nós das listas (decrementar índices maiores que target)
+    // 4) Ajustar índices nos nós das listas (decrementar índices maiores que target)
     for (int i = 0; i < g->n - 1; ++i) {
         AdjNode *curr = g->vertices[i].head;
         while (curr) {
             if (curr->v > target) curr->v--;
             curr = curr->next;
         }
+        if (g->vertices[i].hub) hub_build(&g->vertices[i]); // chaves mudaram
     }
+    name_index_shift_after(g, target);
+    for (int i = 0; i < g->n - 1; ++i) // índice de graus: renumerar sem mudar a ordem
+        if (g->deg.order[i] > target) g->deg.pos[--g->deg.order[i]] = i;
+        else g->deg.pos[g->deg.order[i]] = i;
 
     g->n--;
-    return 0;
+    // 5) Espelho em bits: reconstruir (linhas e colunas deslocadas)
+    if (g->bm.bits && bitmatrix_build(g, g->bm.words * 64) != 0)
+        graph_disable_bitmatrix(g);
+    name_arena_maybe_compact(g);
+    STAT_RETURN(t_remove_vertex, 0);
 }
 
 /* Remove vértice por nome */
@@ -241,208 +1285,4886 @@ int remove_vertex(Graph *g, const char *name) {
     return remove_vertex_by_index(g, idx);
 }
 
-/* ----- Exibição ----- */
+/* Troca, na lista de w, a ocorrência de from por to */
+static void relabel_in_list(Vertex *w, int from, int to) {
+    if (w->hub) {
+        int i = nbrset_find(w->hub, from);
+        if (i == -1) return;
+        AdjNode *node = w->hub->slots[i].node;
+        node->v = to;
+        nbrset_erase_slot(w->hub, i);
+        nbrset_place(w->hub->slots, w->hub->cap, to, node);
+        w->hub->count++;
+        return;
+    }
+    for (AdjNode *curr = w->head; curr; curr = curr->next)
+        if (curr->v == from) { curr->v = to; return; }
+}
+
+/* Remoção rápida: o último vértice ocupa o lugar de target.
+   Só percorre as listas dos vizinhos de target e do vértice movido, sem
+   deslocar o vetor; a ordem dos índices muda, os ids externos não. */
+int remove_vertex_fast_by_index(Graph *g, int target) {
+    if (target < 0 || target >= g->n) return -1;
+    g->uf.dirty = 1;
+    int last = g->n - 1;
+    Vertex *t = &g->vertices[target];
+
+    // 1) Remover target das listas dos seus vizinhos
+    for (AdjNode *curr = t->head; curr; curr = curr->next) {
+        adj_unlink(g, curr->v, target);
+        if (g->bm.bits) bm_clear(&g->bm, curr->v, target);
+    }
+
+    // 2) Liberar o próprio vértice
+    name_index_remove(g, target);
+    g->id_to_index[t->id] = -1;
+    deg_pop(&g->deg, target, t->degree);
+    vertex_release_adj(g, target);
+    name_arena_release(g, target);
+
+    // 3) Mover o último vértice para a posição liberada
+    if (target != last) {
+        Vertex *l = &g->vertices[last];
+        for (AdjNode *curr = l->head; curr; curr = curr->next) {
+            relabel_in_list(&g->vertices[curr->v], last, target);
+            if (g->bm.bits) {
+                bm_clear(&g->bm, curr->v, last);
+                bm_set(&g->bm, curr->v, target);
+            }
+        }
+        name_index_reassign(g, last, target);
+        g->id_to_index[l->id] = target;
+        g->deg.pos[target] = g->deg.pos[last];
+        g->deg.order[g->deg.pos[target]] = target;
+        *t = *l;
+        if (g->bm.bits)
+            memcpy(bm_row(&g->bm, target), bm_row(&g->bm, last), sizeof(uint64_t) * (size_t)g->bm.words);
+    }
+    if (g->bm.bits) memset(bm_row(&g->bm, last), 0, sizeof(uint64_t) * (size_t)g->bm.words);
+    g->vertices[last].head = NULL;
+    g->vertices[last].hub = NULL;
+    g->n--;
+    name_arena_maybe_compact(g);
+    return 0;
+}
+
+/* Remoção rápida por nome */
+int remove_vertex_fast(Graph *g, const char *name) {
+    int idx = find_vertex_index(g, name);
+    if (idx == -1) return -1;
+    return remove_vertex_fast_by_index(g, idx);
+}
+
+/* Índice atual do vértice com id externo id; -1 se não existe */
+int vertex_index_by_id(Graph *g, int id) {
+    if (id < 0 || id >= g->next_id) return -1;
+    return g->id_to_index[id];
+}
+
+/* ----- Inserção de arestas em lote ----- */
+
+/* Ordena chaves de 64 bits (radix LSD com dígitos de 16 bits; pula dígitos constantes) */
+static int radix_sort_u64(uint64_t *keys, size_t m) {
+    if (m < 2) return 0;
+    uint64_t *tmp = malloc(sizeof(uint64_t) * m);
+    size_t *count = malloc(sizeof(size_t) * 65536);
+    if (!tmp || !count) { free(tmp); free(count); return -1; }
+    uint64_t *src = keys, *dst = tmp;
+    for (int shift = 0; shift < 64; shift += 16) {
+        memset(count, 0, sizeof(size_t) * 65536);
+        for (size_t i = 0; i < m; ++i) count[(src[i] >> shift) & 0xFFFF]++;
+        if (count[(src[0] >> shift) & 0xFFFF] == m) continue; // dígito igual em todas
+        size_t sum = 0;
+        for (int d = 0; d < 65536; ++d) { size_t c = count[d]; count[d] = sum; sum += c; }
+        for (size_t i = 0; i < m; ++i) dst[count[(src[i] >> shift) & 0xFFFF]++] = src[i];
+        uint64_t *t = src; src = dst; dst = t;
+    }
+    if (src != keys) memcpy(keys, src, sizeof(uint64_t) * m);
+    free(tmp);
+    free(count);
+    return 0;
+}
+
+/* Insere m arestas dadas por pares de índices (pairs[2i], pairs[2i+1]).
+   Pares inválidos, laços, repetidos e arestas já existentes são ignorados.
+   Ordena e deduplica em lote, conta os graus, aloca todos os nós de uma vez
+   e monta as listas numa única passada (vizinhos novos de cada vértice
+   ficam contíguos na memória). Retorna arestas inseridas ou -1 sem memória. */
+long long add_edges_batch(Graph *g, const int *pairs, size_t m) {
+    uint64_t *keys = malloc(sizeof(uint64_t) * (m > 0 ? m : 1));
+    if (!keys) return -1;
+    size_t k = 0;
+    for (size_t i = 0; i < m; ++i) {
+        int u = pairs[2 * i], v = pairs[2 * i + 1];
+        if (u < 0 || v < 0 || u >= g->n || v >= g->n || u == v) continue;
+        if (u > v) { int t = u; u = v; v = t; }
+        keys[k++] = ((uint64_t)u << 32) | (uint32_t)v;
+    }
+    if (radix_sort_u64(keys, k) != 0) { free(keys); return -1; }
+
+    // deduplicar e descartar arestas já presentes (marcando os vizinhos de cada u)
+    int *deg = calloc((size_t)g->n + 1, sizeof(int));
+    int *mark = malloc(sizeof(int) * (size_t)(g->n > 0 ? g->n : 1));
+    if (!deg || !mark) { free(keys); free(deg); free(mark); return -1; }
+    for (int i = 0; i < g->n; ++i) mark[i] = -1;
+    size_t uniq = 0;
+    for (size_t i = 0; i < k; ++i) {
+        if (i > 0 && keys[i] == keys[i - 1]) continue;
+        int u = (int)(keys[i] >> 32), v = (int)(uint32_t)keys[i];
+        if (i == 0 || (int)(keys[i - 1] >> 32) != u)
+            for (AdjNode *curr = g->vertices[u].head; curr; curr = curr->next) mark[curr->v] = u;
+        if (mark[v] == u) continue;
+        keys[uniq++] = keys[i];
+        deg[u]++;
+        deg[v]++;
+    }
+    free(mark);
+    if (uniq == 0) { free(keys); free(deg); return 0; }
+
+    // offsets de cada vértice no bloco de nós
+    AdjNode *block = adj_pool_alloc_block(&g->pool, 2 * uniq);
+    if (!block) { free(keys); free(deg); return -1; }
+    size_t *pos = malloc(sizeof(size_t) * ((size_t)g->n + 1));
+    if (!pos) { free(keys); free(deg); return -1; }
+    size_t sum = 0;
+    for (int u = 0; u < g->n; ++u) { pos[u] = sum; sum += (size_t)deg[u]; }
+    pos[g->n] = sum;
+    for (size_t i = 0; i < uniq; ++i) {
+        int u = (int)(keys[i] >> 32), v = (int)(uint32_t)keys[i];
+        block[pos[u]].v = v;
+        block[pos[u]++].w = 1.0f;
+        block[pos[v]].v = u;
+        block[pos[v]++].w = 1.0f;
+        if (g->bm.bits) {
+            bm_set(&g->bm, u, v);
+            bm_set(&g->bm, v, u);
+        }
+        if (!g->uf.dirty) uf_union(&g->uf, u, v);
+    }
+    // encadear cada faixa contígua na frente da lista existente
+    size_t start = 0;
+    for (int u = 0; u < g->n; ++u) {
+        size_t end = start + (size_t)deg[u];
+        if (end > start) {
+            Vertex *x = &g->vertices[u];
+            for (size_t j = start; j + 1 < end; ++j) block[j].next = &block[j + 1];
+            block[end - 1].next = x->head;
+            x->head = &block[start];
+            for (int j = 0; j < deg[u]; ++j) deg_inc(&g->deg, u, x->degree++);
+            if (x->hub) {
+                for (size_t j = start; j < end && x->hub; ++j) hub_note_insert(x, &block[j]);
+            } else if (x->degree >= HUB_DEGREE) {
+                hub_build(x);
+            }
+        }
+        start = end;
+    }
+    free(pos);
+    free(deg);
+    free(keys);
+    return (long long)uniq;
+}
+
+/* Inserção em lote por nomes: names[2i] -- names[2i+1]; nomes inexistentes são ignorados */
+long long add_edges_batch_by_name(Graph *g, const char *const *names, size_t m) {
+    int *pairs = malloc(sizeof(int) * 2 * (m > 0 ? m : 1));
+    if (!pairs) return -1;
+    for (size_t i = 0; i < m; ++i) {
+        pairs[2 * i] = find_vertex_index(g, names[2 * i]);
+        pairs[2 * i + 1] = find_vertex_index(g, names[2 * i + 1]);
+    }
+    long long r = add_edges_batch(g, pairs, m);
+    free(pairs);
+    return r;
+}
+
+/* ----- Reordenação de vértices (localidade de memória) ----- */
+
+static int cmp_adj_node(const void *a, const void *b) {
+    int x = ((const AdjNode*)a)->v, y = ((const AdjNode*)b)->v;
+    return (x > y) - (x < y);
+}
+
+static int cmp_u64(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t*)a, y = *(const uint64_t*)b;
+    return (x > y) - (x < y);
+}
+
+/* Nova ordem dos vértices: perm[novo] = antigo. Grau usa o índice de graus
+   direto; BFS e RCM fazem uma BFS por componente (BFS começa no vértice de
+   maior grau, RCM no de menor grau e visita vizinhos por grau crescente,
+   invertendo a ordem no fim). mark: n posições de rascunho. */
+static int reorder_compute(Graph *g, int method, int *perm, int *mark) {
+    int n = g->n;
+    if (method == REORDER_DEGREE) {
+        memcpy(perm, g->deg.order, sizeof(int) * (size_t)n);
+        return 0;
+    }
+    uint64_t *keys = NULL;
+    if (method == REORDER_RCM) {
+        keys = malloc(sizeof(uint64_t) * ((size_t)g->deg.max_degree + 1));
+        if (!keys) return -1;
+    }
+    for (int i = 0; i < n; ++i) mark[i] = 0;
+    int head = 0, tail = 0;
+    for (int s = 0; s < n; ++s) {
+        int src = method == REORDER_RCM ? g->deg.order[n - 1 - s] : g->deg.order[s];
+        if (mark[src]) continue;
+        mark[src] = 1;
+        perm[tail++] = src;
+        while (head < tail) {
+            int first = tail;
+            for (AdjNode *curr = g->vertices[perm[head++]].head; curr; curr = curr->next)
+                if (!mark[curr->v]) {
+                    mark[curr->v] = 1;
+                    perm[tail++] = curr->v;
+                }
+            if (keys && tail - first > 1) {
+                // vizinhos recém-descobertos por grau crescente (empate: índice)
+                int k = tail - first;
+                for (int i = 0; i < k; ++i)
+                    keys[i] = ((uint64_t)g->vertices[perm[first + i]].degree << 32) | (uint32_t)perm[first + i];
+                qsort(keys, (size_t)k, sizeof(uint64_t), cmp_u64);
+                for (int i = 0; i < k; ++i) perm[first + i] = (int)(uint32_t)keys[i];
+            }
+        }
+    }
+    if (keys) {
+        for (int i = 0, j = n - 1; i < j; ++i, --j) { int t = perm[i]; perm[i] = perm[j]; perm[j] = t; }
+        free(keys);
+    }
+    return 0;
+}
+
+/* Renumera os vértices: o antigo perm[i] passa a ter índice i. Refaz as
+   listas num único bloco do pool (vértices na nova ordem, vizinhos em ordem
+   crescente), os conjuntos dos hubs, o índice de nomes, os índices de id,
+   componentes, graus, o espelho em bits e a arena de nomes. Ids externos e
+   nomes não mudam. Retorna 0 sucesso, -1 sem memória (grafo intacto). */
+int graph_apply_order(Graph *g, const int *perm) {
+    int n = g->n;
+    if (n <= 0) return 0;
+    long long m2 = 0;
+    for (int i = 0; i < n; ++i) m2 += g->vertices[i].degree;
+    int *inv = malloc(sizeof(int) * (size_t)n);
+    int *tmp = malloc(sizeof(int) * 2 * (size_t)n);
+    Vertex *nv = malloc(sizeof(Vertex) * (size_t)g->cap);
+    AdjPool np = { NULL, NULL };
+    AdjNode *block = m2 > 0 ? adj_pool_alloc_block(&np, (size_t)m2) : NULL;
+    if (!inv || !tmp || !nv || (m2 > 0 && !block)) {
+        free(inv); free(tmp); free(nv);
+        adj_pool_release(&np);
+        return -1;
+    }
+    for (int i = 0; i < n; ++i) inv[perm[i]] = i;
+
+    // 1) listas novas, contíguas e ordenadas
+    size_t pos = 0;
+    for (int u = 0; u < n; ++u) {
+        Vertex *x = &g->vertices[perm[u]];
+        size_t start = pos;
+        for (AdjNode *curr = x->head; curr; curr = curr->next) {
+            block[pos].v = inv[curr->v];
+            block[pos++].w = curr->w;
+        }
+        nv[u] = *x;
+        nv[u].hub = NULL;
+        nv[u].head = NULL;
+        if (pos > start) {
+            qsort(block + start, pos - start, sizeof(AdjNode), cmp_adj_node);
+            for (size_t j = start; j + 1 < pos; ++j) block[j].next = &block[j + 1];
+            block[pos - 1].next = NULL;
+            nv[u].head = &block[start];
+        }
+    }
+
+    // 2) trocar as estruturas (daqui em diante nada falha)
+    for (int i = 0; i < n; ++i) hub_drop(&g->vertices[i]);
+    adj_pool_release(&g->pool);
+    g->pool = np;
+    free(g->vertices);
+    g->vertices = nv;
+    for (int u = 0; u < n; ++u) {
+        if (nv[u].degree >= HUB_DEGREE) hub_build(&nv[u]);
+        g->id_to_index[nv[u].id] = u;
+    }
+    for (int i = 0; i < g->index.cap; ++i)
+        if (g->index.slots[i].idx >= 0) g->index.slots[i].idx = inv[g->index.slots[i].idx];
+    if (!g->uf.dirty) {
+        for (int i = 0; i < n; ++i) {
+            tmp[inv[i]] = inv[g->uf.parent[i]];
+            tmp[n + inv[i]] = g->uf.size[i];
+        }
+        memcpy(g->uf.parent, tmp, sizeof(int) * (size_t)n);
+        memcpy(g->uf.size, tmp + n, sizeof(int) * (size_t)n);
+    }
+    for (int i = 0; i < n; ++i) {
+        g->deg.order[i] = inv[g->deg.order[i]];
+        g->deg.pos[g->deg.order[i]] = i;
+    }
+    if (g->bm.bits && bitmatrix_build(g, g->bm.words * 64) != 0)
+        graph_disable_bitmatrix(g);
+    name_arena_rewrite(g); // só localidade: sem memória, os nomes continuam válidos
+    free(inv);
+    free(tmp);
+    return 0;
+}
+
+/* Reordena o grafo por method (REORDER_DEGREE, REORDER_BFS ou REORDER_RCM).
+   Índices antigos deixam de valer; use nomes ou ids externos.
+   Retorna 0 sucesso, -1 sem memória ou método inválido. */
+int graph_reorder(Graph *g, int method) {
+    if (method < REORDER_DEGREE || method > REORDER_RCM) return -1;
+    if (g->n == 0) return 0;
+    int *perm = malloc(sizeof(int) * (size_t)g->n);
+    int *mark = malloc(sizeof(int) * (size_t)g->n);
+    int r = perm && mark ? reorder_compute(g, method, perm, mark) : -1;
+    free(mark);
+    if (r == 0) r = graph_apply_order(g, perm);
+    free(perm);
+    return r;
+}
+
+/* Distância média |u - v| entre vizinhos (menor = vizinhos mais próximos na memória) */
+double graph_mean_gap(Graph *g) {
+    long long m2 = 0;
+    double sum = 0.0;
+    for (int u = 0; u < g->n; ++u)
+        for (AdjNode *curr = g->vertices[u].head; curr; curr = curr->next) {
+            sum += abs(curr->v - u);
+            m2++;
+        }
+    return m2 ? sum / (double)m2 : 0.0;
+}
+
+/* ----- Exibição ----- */
+
+/* Ordena pares (u,v) por u e depois por v */
+static int cmp_edge_pair(const void *a, const void *b) {
+    const int *x = a, *y = b;
+    if (x[0] != y[0]) return (x[0] > y[0]) - (x[0] < y[0]);
+    return (x[1] > y[1]) - (x[1] < y[1]);
+}
+
+/* Coleta as arestas (u < v) a partir das listas, ordenadas; retorna vetor
+   alocado com 2*m inteiros (u,v) e grava m em *out_m (NULL se m == 0) */
+int *collect_edges(Graph *g, int *out_m) {
+    int m = 0;
+    for (int u = 0; u < g->n; ++u)
+        for (AdjNode *curr = g->vertices[u].head; curr; curr = curr->next)
+            if (u < curr->v) m++;
+    *out_m = m;
+    if (m == 0) return NULL;
+    int *edges = malloc(sizeof(int) * 2 * (size_t)m);
+    if (!edges) {
+        fprintf(stderr, "Erro: sem memória para arestas.\n");
+        exit(EXIT_FAILURE);
+    }
+    int k = 0;
+    for (int u = 0; u < g->n; ++u)
+        for (AdjNode *curr = g->vertices[u].head; curr; curr = curr->next)
+            if (u < curr->v) {
+                edges[2 * k] = u;
+                edges[2 * k + 1] = curr->v;
+                k++;
+            }
+    qsort(edges, (size_t)m, sizeof(int) * 2, cmp_edge_pair);
+    return edges;
+}
+
+/* Exibe lista de adjacência */
+void display_adj_list(Graph *g) {
+    printf("Lista de Adjacência:\n");
+    for (int i = 0; i < g->n; ++i) {
+        printf(" %d: %s -> ", i, vertex_name(g, i));
+        AdjNode *curr = g->vertices[i].head;
+        if (!curr) printf("NULL");
+        while (curr) {
+            printf("%s", vertex_name(g, curr->v));
+            if (curr->next) printf(" -> ");
+            curr = curr->next;
+        }
+        printf("\n");
+    }
+}
+
+/* Exibe matriz de adjacência (cada linha é montada a partir da lista) */
+void display_adj_matrix(Graph *g) {
+    printf("\nMatriz de Adjacência (0/1):\n    ");
+    for (int j = 0; j < g->n; ++j) {
+        printf("%3d", j);
+    }
+    printf("\n   +");
+    for (int j = 0; j < g->n; ++j) printf("---");
+    printf("\n");
+    int *row = calloc(g->n > 0 ? g->n : 1, sizeof(int));
+    if (!row) { printf("Erro: sem memória.\n"); return; }
+    for (int i = 0; i < g->n; ++i) {
+        for (AdjNode *curr = g->vertices[i].head; curr; curr = curr->next) row[curr->v] = 1;
+        printf("%2d |", i);
+        for (int j = 0; j < g->n; ++j) {
+            printf("%3d", row[j]);
+        }
+        printf("   %s\n", vertex_name(g, i));
+        for (AdjNode *curr = g->vertices[i].head; curr; curr = curr->next) row[curr->v] = 0;
+    }
+    free(row);
+}
+
+/* Gera e exibe matriz de incidência (n x m) */
+void display_incidence_matrix(Graph *g) {
+    // Primeiro, coletar todas as arestas (u < v)
+    int m;
+    int *edges = collect_edges(g, &m); // lista de pares (u,v)
+    printf("\nMatriz de Incidência (%d vértices x %d arestas):\n    ", g->n, m);
+    for (int e = 0; e < m; ++e) printf("%3d", e);
+    printf("\n   +");
+    for (int e = 0; e < m; ++e) printf("---");
+    printf("\n");
+    for (int i = 0; i < g->n; ++i) {
+        printf("%2d |", i);
+        for (int e = 0; e < m; ++e) {
+            int a = edges[2 * e], b = edges[2 * e + 1];
+            if (i == a || i == b) printf("%3d", 1);
+            else printf("%3d", 0);
+        }
+        printf("   %s\n", vertex_name(g, i));
+    }
+    if (m == 0) printf("(Sem arestas)\n");
+    free(edges);
+}
+
+/* Visualização ASCII simples */
+void ascii_visual(Graph *g) {
+    printf("\nVisualização ASCII (lista):\n");
+    for (int i = 0; i < g->n; ++i) {
+        printf("[%d] %s", i, vertex_name(g, i));
+        AdjNode *curr = g->vertices[i].head;
+        if (!curr) { printf(" -- (sem amigos)\n"); continue; }
+        printf(" -- ");
+        int first = 1;
+        while (curr) {
+            if (!first) printf(", ");
+            printf("%s", vertex_name(g, curr->v));
+            first = 0;
+            curr = curr->next;
+        }
+        printf("\n");
+    }
+}
+
+/* ----- Exportação com buffer (DOT, lista de arestas, lista de adjacência) ----- */
+
+#define OUTBUF_SIZE (1 << 20)   // buffer de saída em espaço de usuário
+
+/* Escritor com buffer grande: junta a saída e grava em blocos com fwrite */
+typedef struct {
+    FILE *f;
+    char *buf;
+    size_t len;
+    int err;                // 1 se alguma escrita falhou
+} OutBuf;
+
+int outbuf_open(OutBuf *o, FILE *f) {
+    o->f = f;
+    o->len = 0;
+    o->err = 0;
+    o->buf = malloc(OUTBUF_SIZE);
+    return o->buf ? 0 : -1;
+}
+
+void outbuf_flush(OutBuf *o) {
+    if (o->len && fwrite(o->buf, 1, o->len, o->f) != o->len) o->err = 1;
+    o->len = 0;
+}
+
+/* Descarrega e libera o buffer (não fecha o FILE); retorna 0 ou -1 se houve erro */
+int outbuf_close(OutBuf *o) {
+    outbuf_flush(o);
+    if (fflush(o->f) != 0) o->err = 1;
+    free(o->buf);
+    o->buf = NULL;
+    return o->err ? -1 : 0;
+}
+
+void outbuf_write(OutBuf *o, const char *s, size_t n) {
+    if (n > OUTBUF_SIZE - o->len) {
+        outbuf_flush(o);
+        if (n > OUTBUF_SIZE) {
+            if (fwrite(s, 1, n, o->f) != n) o->err = 1;
+            return;
+        }
+    }
+    memcpy(o->buf + o->len, s, n);
+    o->len += n;
+}
+
+void outbuf_puts(OutBuf *o, const char *s) { outbuf_write(o, s, strlen(s)); }
+
+void outbuf_putc(OutBuf *o, char c) {
+    if (o->len == OUTBUF_SIZE) outbuf_flush(o);
+    o->buf[o->len++] = c;
+}
+
+/* Inteiro em decimal sem passar por printf */
+void outbuf_int(OutBuf *o, int x) {
+    char tmp[12];
+    int i = sizeof(tmp);
+    unsigned int u = x < 0 ? 0u - (unsigned int)x : (unsigned int)x;
+    do { tmp[--i] = (char)('0' + u % 10); u /= 10; } while (u);
+    if (x < 0) tmp[--i] = '-';
+    outbuf_write(o, tmp + i, sizeof(tmp) - (size_t)i);
+}
+
+/* Nome entre aspas para DOT (escapa " e \) */
+static void outbuf_dot_label(OutBuf *o, const char *s) {
+    outbuf_putc(o, '"');
+    for (; *s; ++s) {
+        if (*s == '"' || *s == '\\') outbuf_putc(o, '\\');
+        outbuf_putc(o, *s);
+    }
+    outbuf_putc(o, '"');
+}
+
+/* DOT em O(V + E): arestas u < v direto das listas */
+int export_dot(Graph *g, FILE *f) {
+    OutBuf o;
+    if (outbuf_open(&o, f) != 0) return -1;
+    outbuf_puts(&o, "graph RedeAmizades {\n");
+    // imprimir nós com rótulo como nome
+    for (int i = 0; i < g->n; ++i) {
+        outbuf_puts(&o, "  v");
+        outbuf_int(&o, i);
+        outbuf_puts(&o, " [label=");
+        outbuf_dot_label(&o, vertex_name(g, i));
+        outbuf_puts(&o, "];\n");
+    }
+    // arestas (u < v)
+    for (int u = 0; u < g->n; ++u)
+        for (AdjNode *curr = g->vertices[u].head; curr; curr = curr->next) {
+            if (curr->v < u) continue;
+            outbuf_puts(&o, "  v");
+            outbuf_int(&o, u);
+            outbuf_puts(&o, " -- v");
+            outbuf_int(&o, curr->v);
+            outbuf_puts(&o, ";\n");
+        }
+    outbuf_puts(&o, "}\n");
+    return outbuf_close(&o);
+}
+
+/* Lista de arestas "nome1<sep>nome2", uma por linha. import_edge_list relê
+   as amizades só se nenhum nome tiver , ; TAB, espaço ou \n nem começar com
+   # ou % (não há escape); pessoas sem amigos e pesos não são gravados. */
+int export_edge_list(Graph *g, FILE *f, char sep) {
+    OutBuf o;
+    if (outbuf_open(&o, f) != 0) return -1;
+    for (int u = 0; u < g->n; ++u)
+        for (AdjNode *curr = g->vertices[u].head; curr; curr = curr->next) {
+            if (curr->v < u) continue;
+            outbuf_puts(&o, vertex_name(g, u));
+            outbuf_putc(&o, sep);
+            outbuf_puts(&o, vertex_name(g, curr->v));
+            outbuf_putc(&o, '\n');
+        }
+    return outbuf_close(&o);
+}
+
+/* Lista de adjacência "nome: vizinho1 vizinho2 ..." */
+int export_adj_list(Graph *g, FILE *f) {
+    OutBuf o;
+    if (outbuf_open(&o, f) != 0) return -1;
+    for (int u = 0; u < g->n; ++u) {
+        outbuf_puts(&o, vertex_name(g, u));
+        outbuf_putc(&o, ':');
+        for (AdjNode *curr = g->vertices[u].head; curr; curr = curr->next) {
+            outbuf_putc(&o, ' ');
+            outbuf_puts(&o, vertex_name(g, curr->v));
+        }
+        outbuf_putc(&o, '\n');
+    }
+    return outbuf_close(&o);
+}
+
+/* Exporta no formato fmt ("dot", "edges", "tsv" ou "adj") para filename ("-" = saída padrão) */
+int export_graph(Graph *g, const char *fmt, const char *filename) {
+    FILE *f = strcmp(filename, "-") == 0 ? stdout : fopen(filename, "w");
+    if (!f) return -1;
+    int r;
+    if (strcmp(fmt, "dot") == 0) r = export_dot(g, f);
+    else if (strcmp(fmt, "edges") == 0) r = export_edge_list(g, f, ',');
+    else if (strcmp(fmt, "tsv") == 0) r = export_edge_list(g, f, '\t');
+    else if (strcmp(fmt, "adj") == 0) r = export_adj_list(g, f);
+    else r = -1;
+    if (f != stdout && fclose(f) != 0) r = -1;
+    return r;
+}
+
+/* Gera arquivo .dot para Graphviz */
+void generate_dot(Graph *g, const char *filename) {
+    FILE *f = fopen(filename, "w");
+    if (!f) {
+        perror("Erro ao criar .dot");
+        return;
+    }
+    int r = export_dot(g, f);
+    fclose(f);
+    if (r != 0) { fprintf(stderr, "Erro ao escrever '%s'.\n", filename); return; }
+    printf("\nArquivo '%s' gerado. Visualize com: dot -Tpng %s -o grafo.png\n", filename, filename);
+}
+
+/* ----- Percursos ----- */
+
+/* Fila simples para BFS */
+typedef struct {
+    int *data;
+    int head, tail, cap;
+} Queue;
+
+Queue *queue_create(int cap) {
+    Queue *q = malloc(sizeof(Queue));
+    q->data = malloc(sizeof(int) * cap);
+    q->head = q->tail = 0;
+    q->cap = cap;
+    return q;
+}
+void queue_free(Queue *q) { free(q->data); free(q); }
+int queue_empty(Queue *q) { return q->head == q->tail; }
+void queue_push(Queue *q, int x) { q->data[q->tail++] = x; }
+int queue_pop(Queue *q) { return q->data[q->head++]; }
+
+/* Pilha de cursores para DFS iterativa (reutilizável entre chamadas) */
+typedef struct {
+    AdjNode **data;         // próximo nó a examinar em cada nível do caminho
+    int cap;
+} DfsStack;
+
+void dfs_stack_init(DfsStack *st) {
+    st->data = NULL;
+    st->cap = 0;
+}
+
+/* Garante profundidade para n vértices (retorna 0 sucesso, -1 sem memória) */
+int dfs_stack_reserve(DfsStack *st, int n) {
+    if (n <= st->cap) return 0;
+    AdjNode **nd = realloc(st->data, sizeof(AdjNode*) * (size_t)n);
+    if (!nd) return -1;
+    st->data = nd;
+    st->cap = n;
+    return 0;
+}
+
+void dfs_stack_free(DfsStack *st) {
+    free(st->data);
+    st->data = NULL;
+    st->cap = 0;
+}
+
+/* Contexto de percurso reutilizável: marcas de visita por época (nova
+   consulta = epoch + 1, sem zerar o vetor), fila e pilhas já alocadas.
+   Um contexto por thread; não compartilhar entre consultas simultâneas. */
+typedef struct {
+    uint32_t *stamp;        // stamp[v] == epoch: v visitado na consulta atual
+    uint32_t epoch;
+    Queue queue;            // fila da BFS (pilha de vértices na DFS do CSR)
+    DfsStack stack;         // cursores da DFS sobre listas
+    int *cursor;            // cursores da DFS sobre o CSR (fila reversa na BFS bidirecional)
+    int *parent;            // pais na BFS bidirecional
+    int cap;                // vértices suportados
+} TraversalCtx;
+
+void traversal_ctx_init(TraversalCtx *ctx) {
+    ctx->stamp = NULL;
+    ctx->epoch = 0;
+    ctx->queue.data = NULL;
+    ctx->queue.head = ctx->queue.tail = ctx->queue.cap = 0;
+    dfs_stack_init(&ctx->stack);
+    ctx->cursor = NULL;
+    ctx->parent = NULL;
+    ctx->cap = 0;
+}
+
+/* Garante espaço para n vértices (retorna 0 sucesso, -1 sem memória) */
+int traversal_ctx_reserve(TraversalCtx *ctx, int n) {
+    if (n <= ctx->cap) return 0;
+    uint32_t *ns = realloc(ctx->stamp, sizeof(uint32_t) * (size_t)n);
+    if (!ns) return -1;
+    memset(ns + ctx->cap, 0, sizeof(uint32_t) * (size_t)(n - ctx->cap));
+    ctx->stamp = ns;
+    int *nq = realloc(ctx->queue.data, sizeof(int) * (size_t)n);
+    if (!nq) return -1;
+    ctx->queue.data = nq;
+    ctx->queue.cap = n;
+    int *nc = realloc(ctx->cursor, sizeof(int) * (size_t)n);
+    if (!nc) return -1;
+    ctx->cursor = nc;
+    int *np = realloc(ctx->parent, sizeof(int) * (size_t)n);
+    if (!np) return -1;
+    ctx->parent = np;
+    if (dfs_stack_reserve(&ctx->stack, n) != 0) return -1;
+    ctx->cap = n;
+    return 0;
+}
+
+void traversal_ctx_free(TraversalCtx *ctx) {
+    free(ctx->stamp);
+    free(ctx->queue.data);
+    free(ctx->cursor);
+    free(ctx->parent);
+    dfs_stack_free(&ctx->stack);
+    traversal_ctx_init(ctx);
+}
+
+/* Inicia uma consulta sobre n vértices: nova época e fila vazia */
+int traversal_ctx_begin(TraversalCtx *ctx, int n) {
+    if (traversal_ctx_reserve(ctx, n) != 0) return -1;
+    if (++ctx->epoch == 0) {
+        // contador deu a volta: única situação em que as marcas são zeradas
+        memset(ctx->stamp, 0, sizeof(uint32_t) * (size_t)ctx->cap);
+        ctx->epoch = 1;
+    }
+    ctx->queue.head = ctx->queue.tail = 0;
+    return 0;
+}
+
+static inline int ctx_visited(TraversalCtx *ctx, int v) { return ctx->stamp[v] == ctx->epoch; }
+static inline void ctx_mark(TraversalCtx *ctx, int v) { ctx->stamp[v] = ctx->epoch; }
+
+/* BFS usando o contexto (sem alocação por consulta) */
+int bfs_ctx(Graph *g, TraversalCtx *ctx, int start, int *visited_order, int max_out) {
+    if (start < 0 || start >= g->n) return 0;
+    if (traversal_ctx_begin(ctx, g->n) != 0) return 0;
+    Queue *q = &ctx->queue;
+    ctx_mark(ctx, start);
+    queue_push(q, start);
+    int count = 0;
+    while (!queue_empty(q)) {
+        int u = queue_pop(q);
+        if (count < max_out) visited_order[count] = u;
+        count++;
+        STAT_ADD(edges_scanned, g->vertices[u].degree);
+        AdjNode *curr = g->vertices[u].head;
+        while (curr) {
+            int v = curr->v;
+            if (!ctx_visited(ctx, v)) {
+                ctx_mark(ctx, v);
+                queue_push(q, v);
+            }
+            curr = curr->next;
+        }
+        STAT_MAX(frontier_max, q->tail - q->head);
+    }
+    STAT_ADD(visited, count);
+    return count;
+}
+
+/* BFS: imprime ordem de visita e retorna número de visitados */
+int bfs(Graph *g, int start, int *visited_order, int max_out) {
+    STAT_TIMER_START();
+    TraversalCtx ctx;
+    traversal_ctx_init(&ctx);
+    int count = bfs_ctx(g, &ctx, start, visited_order, max_out);
+    traversal_ctx_free(&ctx);
+    STAT_RETURN(t_bfs, count);
+}
+
+/* DFS iterativa com pilha explícita: mesma ordem da versão recursiva,
+   sem limite de profundidade da pilha de chamadas. Grava no máximo
+   max_out vértices em order e retorna o total visitado. */
+int dfs_ctx(Graph *g, TraversalCtx *ctx, int start, int *order, int max_out) {
+    if (start < 0 || start >= g->n) return 0;
+    if (traversal_ctx_begin(ctx, g->n) != 0) return 0;
+    AdjNode **st = ctx->stack.data;
+    int top = 0, pos = 0;
+    ctx_mark(ctx, start);
+    if (pos < max_out) order[pos] = start;
+    pos++;
+    st[0] = g->vertices[start].head;
+    while (top >= 0) {
+        AdjNode *curr = st[top];
+        if (!curr) { top--; continue; }
+        st[top] = curr->next;
+        STAT_INC(edges_scanned);
+        int v = curr->v;
+        if (ctx_visited(ctx, v)) continue;
+        ctx_mark(ctx, v);
+        if (pos < max_out) order[pos] = v;
+        pos++;
+        st[++top] = g->vertices[v].head;
+        STAT_MAX(frontier_max, top + 1);
+    }
+    STAT_ADD(visited, pos);
+    return pos;
+}
+
+int dfs(Graph *g, int start, int *order, int max_out) {
+    STAT_TIMER_START();
+    TraversalCtx ctx;
+    traversal_ctx_init(&ctx);
+    int pos = dfs_ctx(g, &ctx, start, order, max_out);
+    traversal_ctx_free(&ctx);
+    STAT_RETURN(t_dfs, pos);
+}
+
+/* ----- Consultas (k saltos e menor caminho) ----- */
+
+/* Vértices a distância entre min_k e max_k de start, em ordem de BFS.
+   Para no nível max_k: só a parte necessária do grafo é visitada.
+   Grava no máximo max_out vértices e retorna o total encontrado. */
+int khop_ctx(Graph *g, TraversalCtx *ctx, int start, int min_k, int max_k, int *out, int max_out) {
+    if (start < 0 || start >= g->n || max_k < 0) return 0;
+    if (traversal_ctx_begin(ctx, g->n) != 0) return 0;
+    int *q = ctx->queue.data;
+    int head = 0, tail = 0, count = 0, depth = 0;
+    ctx_mark(ctx, start);
+    q[tail++] = start;
+    if (min_k <= 0) {
+        if (count < max_out) out[count] = start;
+        count++;
+    }
+    while (head < tail && depth < max_k) {
+        int level_end = tail;
+        depth++;
+        while (head < level_end) {
+            int u = q[head++];
+            for (AdjNode *curr = g->vertices[u].head; curr; curr = curr->next) {
+                int v = curr->v;
+                if (ctx_visited(ctx, v)) continue;
+                ctx_mark(ctx, v);
+                q[tail++] = v;
+                if (depth >= min_k) {
+                    if (count < max_out) out[count] = v;
+                    count++;
+                }
+            }
+        }
+    }
+    return count;
+}
+
+/* Amigos de amigos: vértices exatamente a 2 saltos */
+int friends_of_friends_ctx(Graph *g, TraversalCtx *ctx, int start, int *out, int max_out) {
+    return khop_ctx(g, ctx, start, 2, 2, out, max_out);
+}
+
+/* Expande um nível inteiro de um dos lados da BFS bidirecional.
+   Retorna o vértice de encontro (lado oposto) ou -1; *from recebe o vizinho
+   deste lado. Lado direto: parent >= 0; lado reverso: parent = -2 - pai. */
+static int bidir_expand(Graph *g, TraversalCtx *ctx, int *q, int *head, int *tail, int forward, int *from) {
+    int level_end = *tail;
+    while (*head < level_end) {
+        int u = q[(*head)++];
+        for (AdjNode *curr = g->vertices[u].head; curr; curr = curr->next) {
+            int v = curr->v;
+            if (ctx_visited(ctx, v)) {
+                if ((ctx->parent[v] >= 0) != forward) { *from = u; return v; }
+                continue;
+            }
+            ctx_mark(ctx, v);
+            ctx->parent[v] = forward ? u : -2 - u;
+            q[(*tail)++] = v;
+        }
+    }
+    return -1;
+}
+
+/* Menor caminho (não ponderado) entre s e t por BFS bidirecional, sempre
+   expandindo o lado de fronteira menor. Grava até max_len vértices do
+   caminho (s ... t) em path; retorna o número de vértices do caminho ou -1
+   se t não é alcançável a partir de s. */
+int shortest_path_ctx(Graph *g, TraversalCtx *ctx, int s, int t, int *path, int max_len) {
+    if (s < 0 || t < 0 || s >= g->n || t >= g->n) return -1;
+    if (traversal_ctx_begin(ctx, g->n) != 0) return -1;
+    if (s == t) {
+        if (max_len > 0) path[0] = s;
+        return 1;
+    }
+    int *fq = ctx->queue.data, *bq = ctx->cursor;
+    int fh = 0, ft = 0, bh = 0, bt = 0;
+    ctx_mark(ctx, s); ctx->parent[s] = s; fq[ft++] = s;
+    ctx_mark(ctx, t); ctx->parent[t] = -2 - t; bq[bt++] = t;
+    int meet = -1, from = -1, forward = 1;
+    while (fh < ft && bh < bt) {
+        // sem encontro até aqui, o primeiro encontro deste nível é mínimo
+        forward = (ft - fh) <= (bt - bh);
+        if (forward) meet = bidir_expand(g, ctx, fq, &fh, &ft, 1, &from);
+        else meet = bidir_expand(g, ctx, bq, &bh, &bt, 0, &from);
+        if (meet != -1) break;
+    }
+    if (meet == -1) return -1;
+    // a = último vértice do lado direto, b = primeiro do lado reverso
+    int a = forward ? from : meet, b = forward ? meet : from;
+    int len = 0;
+    for (int x = a;; x = ctx->parent[x]) { len++; if (x == s) break; }
+    int left = len;
+    for (int x = b;; x = -2 - ctx->parent[x]) { len++; if (x == t) break; }
+    int i = left - 1;
+    for (int x = a;; x = ctx->parent[x]) {
+        if (i < max_len) path[i] = x;
+        i--;
+        if (x == s) break;
+    }
+    i = left;
+    for (int x = b;; x = -2 - ctx->parent[x]) {
+        if (i < max_len) path[i] = x;
+        i++;
+        if (x == t) break;
+    }
+    return len;
+}
+
+/* Menor caminho por nomes (contexto temporário) */
+int shortest_path(Graph *g, const char *name1, const char *name2, int *path, int max_len) {
+    int s = find_vertex_index(g, name1);
+    int t = find_vertex_index(g, name2);
+    if (s == -1 || t == -1) return -1;
+    TraversalCtx ctx;
+    traversal_ctx_init(&ctx);
+    int len = shortest_path_ctx(g, &ctx, s, t, path, max_len);
+    traversal_ctx_free(&ctx);
+    return len;
+}
+
+/* ----- Menor caminho ponderado (Dijkstra com heap 4-ário) ----- */
+
+/* Entrada do heap: a distância vai junto do vértice, e as comparações não
+   tocam dist[] (um acesso aleatório a menos por nível). */
+typedef struct {
+    double d;
+    int v;
+} HeapEntry;
+
+/* Heap 4-ário de mínimo. O elemento i fica em heap[i + HEAP_BASE]: os
+   filhos 4i+1..4i+4 caem nas posições 4(i+1)..4(i+1)+3, os 64 bytes de uma
+   mesma linha de cache (o vetor é alinhado em 64). Metade da altura de um
+   heap binário, e os quatro filhos comparados custam uma linha só. */
+#define HEAP_BASE 3
+#define HEAP_ALIGN 64
+
+/* Rascunho reutilizável dos caminhos ponderados, um por thread. Marcas por
+   época, predecessores (parent) e posição no heap (cursor, -1 = fixado)
+   vêm do TraversalCtx; depois da primeira consulta do mesmo tamanho de
+   grafo, nenhuma consulta aloca memória. */
+typedef struct {
+    TraversalCtx trav;
+    double *dist;           // distância (válida para vértices marcados em trav)
+    HeapEntry *heap;        // alinhado em HEAP_ALIGN
+    int size;               // elementos no heap
+    int cap;
+} PathCtx;
+
+void path_ctx_init(PathCtx *ctx) {
+    traversal_ctx_init(&ctx->trav);
+    ctx->dist = NULL;
+    ctx->heap = NULL;
+    ctx->size = ctx->cap = 0;
+}
+
+/* Garante espaço para n vértices (retorna 0 sucesso, -1 sem memória) */
+int path_ctx_reserve(PathCtx *ctx, int n) {
+    if (traversal_ctx_reserve(&ctx->trav, n) != 0) return -1;
+    if (n <= ctx->cap) return 0;
+    double *nd = realloc(ctx->dist, sizeof(double) * (size_t)n);
+    if (!nd) return -1;
+    ctx->dist = nd;
+    // o heap só tem conteúdo durante uma consulta: basta alocar de novo
+    size_t bytes = sizeof(HeapEntry) * ((size_t)n + HEAP_BASE + 4);
+    bytes = (bytes + HEAP_ALIGN - 1) / HEAP_ALIGN * HEAP_ALIGN;
+    HeapEntry *nh = aligned_alloc(HEAP_ALIGN, bytes);
+    if (!nh) return -1;
+    free(ctx->heap);
+    ctx->heap = nh;
+    ctx->cap = n;
+    return 0;
+}
+
+void path_ctx_free(PathCtx *ctx) {
+    traversal_ctx_free(&ctx->trav);
+    free(ctx->dist);
+    free(ctx->heap);
+    path_ctx_init(ctx);
+}
+
+/* Sobe e a partir da posição i (inserção ou distância diminuída) */
+static void heap_sift_up(PathCtx *ctx, int i, HeapEntry e) {
+    HeapEntry *h = ctx->heap + HEAP_BASE;
+    int *pos = ctx->trav.cursor;
+    while (i > 0) {
+        int up = (i - 1) >> 2;
+        if (h[up].d <= e.d) break;
+        h[i] = h[up];
+        pos[h[i].v] = i;
+        i = up;
+    }
+    h[i] = e;
+    pos[e.v] = i;
+}
+
+/* Retira o mínimo (heap não vazio) */
+static HeapEntry heap_pop(PathCtx *ctx) {
+    HeapEntry *h = ctx->heap + HEAP_BASE;
+    int *pos = ctx->trav.cursor;
+    HeapEntry top = h[0], e = h[--ctx->size];
+    int n = ctx->size, i = 0;
+    for (;;) {
+        int c = 4 * i + 1;
+        if (c >= n) break;
+        int best = c, last = c + 4 < n ? c + 4 : n;
+        for (int k = c + 1; k < last; ++k)
+            if (h[k].d < h[best].d) best = k;
+        if (h[best].d >= e.d) break;
+        h[i] = h[best];
+        pos[h[i].v] = i;
+        i = best;
+    }
+    if (n > 0) {
+        h[i] = e;
+        pos[e.v] = i;
+    }
+    pos[top.v] = -1;
+    return top;
+}
+
+/* Relaxa a aresta até v com distância d vinda de u */
+static inline void dijkstra_relax(PathCtx *ctx, int u, int v, double d) {
+    TraversalCtx *tc = &ctx->trav;
+    if (!ctx_visited(tc, v)) {
+        ctx_mark(tc, v);
+        ctx->dist[v] = d;
+        tc->parent[v] = u;
+        heap_sift_up(ctx, ctx->size++, (HeapEntry){ d, v });
+    } else if (tc->cursor[v] >= 0 && d < ctx->dist[v]) {
+        ctx->dist[v] = d;
+        tc->parent[v] = u;
+        heap_sift_up(ctx, tc->cursor[v], (HeapEntry){ d, v });
+    }
+}
+
+/* Marca s como origem de uma nova consulta sobre n vértices */
+static int dijkstra_begin(PathCtx *ctx, int n, int s) {
+    if (path_ctx_reserve(ctx, n) != 0 || traversal_ctx_begin(&ctx->trav, n) != 0) return -1;
+    ctx->size = 0;
+    ctx_mark(&ctx->trav, s);
+    ctx->dist[s] = 0.0;
+    ctx->trav.parent[s] = s;
+    heap_sift_up(ctx, ctx->size++, (HeapEntry){ 0.0, s });
+    return 0;
+}
+
+/* Dijkstra a partir de s pelos pesos das arestas; com t >= 0 para assim que
+   t é fixado (consulta ponto a ponto), com t = -1 fixa todo o componente.
+   Distâncias em ctx->dist e predecessores em ctx->trav.parent valem para
+   os vértices fixados. Retorna vértices fixados ou -1 (s inválido ou sem memória). */
+int dijkstra_ctx(Graph *g, PathCtx *ctx, int s, int t) {
+    if (s < 0 || s >= g->n) return -1;
+    if (dijkstra_begin(ctx, g->n, s) != 0) return -1;
+    int settled = 0;
+    while (ctx->size > 0) {
+        HeapEntry e = heap_pop(ctx);
+        settled++;
+        if (e.v == t) break;
+        for (AdjNode *curr = g->vertices[e.v].head; curr; curr = curr->next) {
+            STAT_INC(edges_scanned);
+            dijkstra_relax(ctx, e.v, curr->v, e.d + curr->w);
+        }
+    }
+    return settled;
+}
+
+/* Caminho s ... t pelos predecessores de uma busca que fixou t:
+   grava até max_len vértices em path e retorna o tamanho do caminho */
+static int path_from_parents(const PathCtx *ctx, int s, int t, int *path, int max_len) {
+    int len = 1;
+    for (int x = t; x != s; x = ctx->trav.parent[x]) len++;
+    int i = len - 1;
+    for (int x = t;; x = ctx->trav.parent[x]) {
+        if (i < max_len) path[i] = x;
+        i--;
+        if (x == s) break;
+    }
+    return len;
+}
+
+/* Menor caminho ponderado entre s e t: grava até max_len vértices do
+   caminho (s ... t) em path e o custo em *cost. Sem pesos definidos o custo
+   é o número de saltos. Retorna vértices do caminho ou -1 se t não é
+   alcançável (ou sem memória). */
+int weighted_path_ctx(Graph *g, PathCtx *ctx, int s, int t, int *path, int max_len, double *cost) {
+    if (t < 0 || t >= g->n) return -1;
+    if (dijkstra_ctx(g, ctx, s, t) < 0) return -1;
+    if (!ctx_visited(&ctx->trav, t)) return -1;
+    *cost = ctx->dist[t];
+    return path_from_parents(ctx, s, t, path, max_len);
+}
+
+/* Menor caminho ponderado por nomes (contexto temporário) */
+int weighted_path(Graph *g, const char *name1, const char *name2, int *path, int max_len, double *cost) {
+    int s = find_vertex_index(g, name1);
+    int t = find_vertex_index(g, name2);
+    if (s == -1 || t == -1) return -1;
+    PathCtx ctx;
+    path_ctx_init(&ctx);
+    int len = weighted_path_ctx(g, &ctx, s, t, path, max_len, cost);
+    path_ctx_free(&ctx);
+    return len;
+}
+
+/* ----- Sugestão de amizades (pessoas que você talvez conheça) ----- */
+
+typedef struct {
+    int v;                  // pessoa sugerida
+    int mutual;             // amigos em comum
+    double score;           // pontuação pela métrica escolhida
+} Recommendation;
+
+/* Rascunho reutilizável das sugestões; um por thread. Depois da primeira
+   consulta do mesmo tamanho de grafo, nenhuma consulta aloca memória. */
+typedef struct {
+    TraversalCtx trav;      // marcas por época; a fila guarda os candidatos tocados
+    int *mutual;            // amigos em comum (-1 = o próprio ou já amigo)
+    double *score;
+    int cap;
+    Recommendation *heap;   // heap de mínimo com os k melhores
+    int heap_cap;
+} RecommendCtx;
+
+void recommend_ctx_init(RecommendCtx *ctx) {
+    traversal_ctx_init(&ctx->trav);
+    ctx->mutual = NULL;
+    ctx->score = NULL;
+    ctx->cap = 0;
+    ctx->heap = NULL;
+    ctx->heap_cap = 0;
+}
+
+/* Garante espaço para n vértices e k sugestões (retorna 0 sucesso, -1 sem memória) */
+int recommend_ctx_reserve(RecommendCtx *ctx, int n, int k) {
+    if (traversal_ctx_reserve(&ctx->trav, n) != 0) return -1;
+    if (n > ctx->cap) {
+        int *nm = realloc(ctx->mutual, sizeof(int) * (size_t)n);
+        if (!nm) return -1;
+        ctx->mutual = nm;
+        double *ns = realloc(ctx->score, sizeof(double) * (size_t)n);
+        if (!ns) return -1;
+        ctx->score = ns;
+        ctx->cap = n;
+    }
+    if (k > ctx->heap_cap) {
+        Recommendation *nh = realloc(ctx->heap, sizeof(Recommendation) * (size_t)k);
+        if (!nh) return -1;
+        ctx->heap = nh;
+        ctx->heap_cap = k;
+    }
+    return 0;
+}
+
+void recommend_ctx_free(RecommendCtx *ctx) {
+    traversal_ctx_free(&ctx->trav);
+    free(ctx->mutual);
+    free(ctx->score);
+    free(ctx->heap);
+    recommend_ctx_init(ctx);
+}
+
+/* a é pior que b: pontuação menor; no empate, índice maior */
+static inline int rec_worse(const Recommendation *a, const Recommendation *b) {
+    if (a->score != b->score) return a->score < b->score;
+    return a->v > b->v;
+}
+
+static void rec_sift_down(Recommendation *h, int n, int i) {
+    while (1) {
+        int l = 2 * i + 1, r = l + 1, m = i;
+        if (l < n && rec_worse(&h[l], &h[m])) m = l;
+        if (r < n && rec_worse(&h[r], &h[m])) m = r;
+        if (m == i) return;
+        Recommendation t = h[i]; h[i] = h[m]; h[m] = t;
+        i = m;
+    }
+}
+
+static void rec_sift_up(Recommendation *h, int i) {
+    while (i > 0) {
+        int p = (i - 1) / 2;
+        if (!rec_worse(&h[i], &h[p])) return;
+        Recommendation t = h[i]; h[i] = h[p]; h[p] = t;
+        i = p;
+    }
+}
+
+/* Até k não amigos de u com maior pontuação (metric = RECOMMEND_MUTUAL ou
+   RECOMMEND_ADAMIC_ADAR), do melhor para o pior, em out (k posições).
+   Custo O(soma dos graus dos amigos de u + c log k), c = candidatos tocados.
+   Retorna quantas sugestões foram gravadas ou -1 se inválido/sem memória. */
+int recommend_friends_ctx(Graph *g, RecommendCtx *ctx, int u, int k, int metric, Recommendation *out) {
+    if (u < 0 || u >= g->n || k < 0) return -1;
+    if (k == 0) return 0;
+    if (recommend_ctx_reserve(ctx, g->n, k) != 0 || traversal_ctx_begin(&ctx->trav, g->n) != 0) return -1;
+    TraversalCtx *t = &ctx->trav;
+    int *touched = t->queue.data, nt = 0;
+    // o próprio u e seus amigos ficam marcados como excluídos
+    ctx_mark(t, u);
+    ctx->mutual[u] = -1;
+    for (AdjNode *w = g->vertices[u].head; w; w = w->next) {
+        ctx_mark(t, w->v);
+        ctx->mutual[w->v] = -1;
+    }
+    // cada amigo w contribui para os seus amigos (caminhos u - w - x)
+    for (AdjNode *w = g->vertices[u].head; w; w = w->next) {
+        int dw = g->vertices[w->v].degree;
+        if (dw < 2) continue; // só conhece u
+        double weight = metric == RECOMMEND_ADAMIC_ADAR ? 1.0 / log((double)dw) : 1.0;
+        for (AdjNode *x = g->vertices[w->v].head; x; x = x->next) {
+            int v = x->v;
+            if (!ctx_visited(t, v)) {
+                ctx_mark(t, v);
+                ctx->mutual[v] = 0;
+                ctx->score[v] = 0.0;
+                touched[nt++] = v;
+            }
+            if (ctx->mutual[v] < 0) continue;
+            ctx->mutual[v]++;
+            ctx->score[v] += weight;
+        }
+    }
+    // seleção dos k melhores com heap de mínimo limitado
+    Recommendation *h = ctx->heap;
+    int hn = 0;
+    for (int i = 0; i < nt; ++i) {
+        Recommendation r = { touched[i], ctx->mutual[touched[i]], ctx->score[touched[i]] };
+        if (hn < k) {
+            h[hn] = r;
+            rec_sift_up(h, hn++);
+        } else if (rec_worse(&h[0], &r)) {
+            h[0] = r;
+            rec_sift_down(h, hn, 0);
+        }
+    }
+    // esvazia o heap do pior para o melhor, preenchendo out de trás para frente
+    int count = hn;
+    while (hn > 0) {
+        out[hn - 1] = h[0];
+        h[0] = h[--hn];
+        rec_sift_down(h, hn, 0);
+    }
+    return count;
+}
+
+/* ----- Snapshot CSR (somente leitura) ----- */
+
+/* Grafo congelado em formato CSR: vizinhos de u em nbrs[offsets[u] .. offsets[u+1]) */
+typedef struct {
+    int n;                  // número de vértices
+    int m2;                 // número de meias-arestas (2 * arestas)
+    int *offsets;           // n + 1 posições
+    int *nbrs;              // vizinhos contíguos
+    float *weights;         // pesos paralelos a nbrs (NULL = todos 1)
+    int sorted;             // 1 se cada faixa de vizinhos está ordenada
+} CSRGraph;
+
+static int cmp_int(const void *a, const void *b) {
+    int x = *(const int*)a, y = *(const int*)b;
+    return (x > y) - (x < y);
+}
+
+/* Preenche nbrs e weights (estrutura de vetores: os percursos sem peso
+   não trazem os pesos para o cache); a ordenação leva o par vizinho/peso */
+static int freeze_weighted(Graph *g, CSRGraph *c, int sort) {
+    c->weights = malloc(sizeof(float) * (c->m2 > 0 ? (size_t)c->m2 : 1));
+    AdjNode *tmp = sort ? malloc(sizeof(AdjNode) * ((size_t)g->deg.max_degree + 1)) : NULL;
+    if (!c->weights || (sort && !tmp)) {
+        free(tmp);
+        free(c->offsets);
+        free(c->nbrs);
+        free(c->weights);
+        c->offsets = c->nbrs = NULL;
+        c->weights = NULL;
+        return -1;
+    }
+    for (int u = 0; u < g->n; ++u) {
+        int k = c->offsets[u], d = 0;
+        for (AdjNode *curr = g->vertices[u].head; curr; curr = curr->next) {
+            if (sort) tmp[d++] = *curr;
+            else {
+                c->nbrs[k] = curr->v;
+                c->weights[k++] = curr->w;
+            }
+        }
+        if (!sort) continue;
+        qsort(tmp, (size_t)d, sizeof(AdjNode), cmp_adj_node);
+        for (int i = 0; i < d; ++i) {
+            c->nbrs[k + i] = tmp[i].v;
+            c->weights[k + i] = tmp[i].w;
+        }
+    }
+    free(tmp);
+    return 0;
+}
+
+/* Congela g em c; sort != 0 ordena os vizinhos de cada vértice
+   (retorna 0 sucesso, -1 sem memória ou grafo grande demais) */
+int freeze_graph(Graph *g, CSRGraph *c, int sort) {
+    c->n = g->n;
+    c->m2 = 0;
+    c->nbrs = NULL;
+    c->weights = NULL;
+    c->sorted = sort != 0;
+    c->offsets = malloc(sizeof(int) * ((size_t)g->n + 1));
+    if (!c->offsets) return -1;
+    long long total = 0;
+    for (int u = 0; u < g->n; ++u) {
+        c->offsets[u] = (int)total;
+        total += g->vertices[u].degree;
+        if (total > INT_MAX) { free(c->offsets); c->offsets = NULL; return -1; }
+    }
+    c->offsets[g->n] = (int)total;
+    c->m2 = (int)total;
+    c->nbrs = malloc(sizeof(int) * (total > 0 ? (size_t)total : 1));
+    if (!c->nbrs) { free(c->offsets); c->offsets = NULL; return -1; }
+    if (g->weighted) return freeze_weighted(g, c, sort);
+    // mantém a ordem das listas, para percursos idênticos aos do grafo mutável
+    for (int u = 0; u < g->n; ++u) {
+        int k = c->offsets[u];
+        for (AdjNode *curr = g->vertices[u].head; curr; curr = curr->next) c->nbrs[k++] = curr->v;
+        if (sort) qsort(c->nbrs + c->offsets[u], (size_t)(k - c->offsets[u]), sizeof(int), cmp_int);
+    }
+    return 0;
+}
+
+void csr_free(CSRGraph *c) {
+    free(c->offsets);
+    free(c->nbrs);
+    free(c->weights);
+    c->offsets = NULL;
+    c->nbrs = NULL;
+    c->weights = NULL;
+    c->n = c->m2 = 0;
+}
+
+/* Grau do vértice u (O(1)) */
+int csr_degree(CSRGraph *c, int u) {
+    if (u < 0 || u >= c->n) return -1;
+    return c->offsets[u + 1] - c->offsets[u];
+}
+
+/* Verifica aresta u-v: busca binária se ordenado, senão varredura da faixa */
+int csr_has_edge(CSRGraph *c, int u, int v) {
+    if (u < 0 || u >= c->n) return 0;
+    const int *lo = c->nbrs + c->offsets[u], *hi = c->nbrs + c->offsets[u + 1];
+    if (c->sorted) return bsearch(&v, lo, (size_t)(hi - lo), sizeof(int), cmp_int) != NULL;
+    for (; lo < hi; ++lo) if (*lo == v) return 1;
+    return 0;
+}
+
+/* BFS sobre o CSR usando o contexto: mesmo contrato de bfs() */
+int csr_bfs_ctx(CSRGraph *c, TraversalCtx *ctx, int start, int *visited_order, int max_out) {
+    if (start < 0 || start >= c->n) return 0;
+    if (traversal_ctx_begin(ctx, c->n) != 0) return 0;
+    int *queue = ctx->queue.data;
+    int head = 0, tail = 0;
+    ctx_mark(ctx, start);
+    queue[tail++] = start;
+    while (head < tail) {
+        int u = queue[head++];
+        for (int k = c->offsets[u]; k < c->offsets[u + 1]; ++k) {
+            int v = c->nbrs[k];
+            if (!ctx_visited(ctx, v)) {
+                ctx_mark(ctx, v);
+                queue[tail++] = v;
+            }
+        }
+    }
+    // a fila já é a ordem de visita
+    int count = tail;
+    memcpy(visited_order, queue, sizeof(int) * (size_t)(count < max_out ? count : max_out));
+    return count;
+}
+
+int csr_bfs(CSRGraph *c, int start, int *visited_order, int max_out) {
+    TraversalCtx ctx;
+    traversal_ctx_init(&ctx);
+    int count = csr_bfs_ctx(c, &ctx, start, visited_order, max_out);
+    traversal_ctx_free(&ctx);
+    return count;
+}
+
+/* Dijkstra sobre o CSR: mesmo contrato de dijkstra_ctx() (sem weights, peso 1) */
+int csr_dijkstra_ctx(CSRGraph *c, PathCtx *ctx, int s, int t) {
+    if (s < 0 || s >= c->n) return -1;
+    if (dijkstra_begin(ctx, c->n, s) != 0) return -1;
+    const float *w = c->weights;
+    int settled = 0;
+    while (ctx->size > 0) {
+        HeapEntry e = heap_pop(ctx);
+        settled++;
+        if (e.v == t) break;
+        for (int k = c->offsets[e.v]; k < c->offsets[e.v + 1]; ++k)
+            dijkstra_relax(ctx, e.v, c->nbrs[k], e.d + (w ? w[k] : 1.0f));
+    }
+    return settled;
+}
+
+/* DFS sobre o CSR com pilha explícita de cursores (mesma ordem da versão recursiva) */
+int csr_dfs_ctx(CSRGraph *c, TraversalCtx *ctx, int start, int *order, int max_out) {
+    if (start < 0 || start >= c->n) return 0;
+    if (traversal_ctx_begin(ctx, c->n) != 0) return 0;
+    int *stack = ctx->queue.data;   // vértices
+    int *cursor = ctx->cursor;      // próxima aresta de cada nível
+    int top = 0, pos = 0;
+    ctx_mark(ctx, start);
+    if (pos < max_out) order[pos] = start;
+    pos++;
+    stack[0] = start;
+    cursor[0] = c->offsets[start];
+    while (top >= 0) {
+        int u = stack[top];
+        if (cursor[top] == c->offsets[u + 1]) { top--; continue; }
+        int v = c->nbrs[cursor[top]++];
+        if (ctx_visited(ctx, v)) continue;
+        ctx_mark(ctx, v);
+        if (pos < max_out) order[pos] = v;
+        pos++;
+        ++top;
+        stack[top] = v;
+        cursor[top] = c->offsets[v];
+    }
+    return pos;
+}
+
+int csr_dfs(CSRGraph *c, int start, int *order, int max_out) {
+    TraversalCtx ctx;
+    traversal_ctx_init(&ctx);
+    int pos = csr_dfs_ctx(c, &ctx, start, order, max_out);
+    traversal_ctx_free(&ctx);
+    return pos;
+}
+
+/* BFS com otimização de direção (Beamer): expande de cima para baixo enquanto
+   a fronteira é pequena e passa a procurar, para cada vértice não visitado,
+   um pai na fronteira (bitmap) quando a fronteira cobre boa parte das arestas.
+   Mesmo contrato de bfs(); level (opcional, n posições) recebe a distância
+   ou -1. Os conjuntos por nível são os mesmos de bfs(); dentro de um nível
+   feito de baixo para cima a ordem é a dos índices. */
+int csr_bfs_do(CSRGraph *c, int start, int *visited_order, int max_out, int *level) {
+    if (start < 0 || start >= c->n) return 0;
+    int n = c->n;
+    size_t words = ((size_t)n + 63) / 64;
+    uint64_t *visited = calloc(words * 2, sizeof(uint64_t));
+    int *queue = malloc(sizeof(int) * (size_t)n);  // ordem de visita; nível atual = [lo, hi)
+    if (!visited || !queue) { free(visited); free(queue); return 0; }
+    uint64_t *front = visited + words;
+    if (level) for (int i = 0; i < n; ++i) level[i] = -1;
+
+    visited[start >> 6] |= 1ULL << (start & 63);
+    if (level) level[start] = 0;
+    queue[0] = start;
+    int lo = 0, hi = 1, depth = 0, bottom_up = 0;
+    long long m_u = c->m2 - csr_degree(c, start); // arestas ainda não exploradas
+    while (lo < hi) {
+        long long m_f = 0;
+        for (int i = lo; i < hi; ++i) m_f += csr_degree(c, queue[i]);
+        int n_f = hi - lo;
+        if (!bottom_up && m_f > m_u / BFS_DO_ALPHA) bottom_up = 1;
+        else if (bottom_up && n_f < n / BFS_DO_BETA) bottom_up = 0;
+
+        int tail = hi;
+        depth++;
+        if (!bottom_up) {
+            for (int i = lo; i < hi; ++i) {
+                int u = queue[i];
+                for (int k = c->offsets[u]; k < c->offsets[u + 1]; ++k) {
+                    int v = c->nbrs[k];
+                    uint64_t bit = 1ULL << (v & 63);
+                    if (visited[v >> 6] & bit) continue;
+                    visited[v >> 6] |= bit;
+                    if (level) level[v] = depth;
+                    queue[tail++] = v;
+                }
+            }
+        } else {
+            memset(front, 0, sizeof(uint64_t) * words);
+            for (int i = lo; i < hi; ++i) front[queue[i] >> 6] |= 1ULL << (queue[i] & 63);
+            for (size_t w = 0; w < words; ++w) {
+                uint64_t todo = ~visited[w];
+                if (w == words - 1 && (n & 63)) todo &= (1ULL << (n & 63)) - 1;
+                while (todo) {
+                    int v = (int)(w * 64) + ctz64(todo);
+                    todo &= todo - 1;
+                    for (int k = c->offsets[v]; k < c->offsets[v + 1]; ++k) {
+                        int p = c->nbrs[k];
+                        if (front[p >> 6] & (1ULL << (p & 63))) {
+                            visited[w] |= 1ULL << (v & 63);
+                            if (level) level[v] = depth;
+                            queue[tail++] = v;
+                            break;
+                        }
+                    }
+                }
+            }
+        }
+        for (int i = hi; i < tail; ++i) m_u -= csr_degree(c, queue[i]);
+        lo = hi;
+        hi = tail;
+    }
+    int count = hi;
+    memcpy(visited_order, queue, sizeof(int) * (size_t)(count < max_out ? count : max_out));
+    free(visited);
+    free(queue);
+    return count;
+}
+
+/* ----- BFS paralela (síncrona por nível) ----- */
+
+/* Buffer local de cada thread com os vértices descobertos no nível */
+typedef struct {
+    int *data;
+    int size, cap;
+    int offset;             // posição de cópia no vetor de ordem
+} LocalFrontier;
+
+typedef struct {
+    CSRGraph *c;
+    _Atomic uint64_t *visited;  // bitmap de visitados (atualizado com fetch_or)
+    int *order;                 // ordem de visita; nível atual = [lo, hi)
+    int *level;                 // distâncias (opcional)
+    int lo, hi, depth;
+    atomic_int cursor;          // próximo índice da fronteira a distribuir
+    int nthreads;
+    pthread_barrier_t barrier;
+    LocalFrontier *local;
+} ParBFS;
+
+typedef struct {
+    ParBFS *st;
+    int tid;
+} ParBFSArg;
+
+static void local_push(LocalFrontier *lf, int v) {
+    if (lf->size == lf->cap) {
+        int ncap = lf->cap ? lf->cap * 2 : 1024;
+        int *nd = realloc(lf->data, sizeof(int) * (size_t)ncap);
+        if (!nd) {
+            fprintf(stderr, "Erro: sem memória para fronteira.\n");
+            exit(EXIT_FAILURE);
+        }
+        lf->data = nd;
+        lf->cap = ncap;
+    }
+    lf->data[lf->size++] = v;
+}
+
+static void *par_bfs_worker(void *p) {
+    ParBFSArg *arg = p;
+    ParBFS *st = arg->st;
+    LocalFrontier *mine = &st->local[arg->tid];
+    CSRGraph *c = st->c;
+    while (st->lo < st->hi) {
+        // 1) expandir pedaços da fronteira
+        int depth = st->depth + 1;
+        while (1) {
+            int i = atomic_fetch_add_explicit(&st->cursor, PAR_BFS_CHUNK, memory_order_relaxed) + st->lo;
+            if (i >= st->hi) break;
+            int end = i + PAR_BFS_CHUNK < st->hi ? i + PAR_BFS_CHUNK : st->hi;
+            for (; i < end; ++i) {
+                int u = st->order[i];
+                for (int k = c->offsets[u]; k < c->offsets[u + 1]; ++k) {
+                    int v = c->nbrs[k];
+                    uint64_t bit = 1ULL << (v & 63);
+                    _Atomic uint64_t *w = &st->visited[v >> 6];
+                    if (atomic_load_explicit(w, memory_order_relaxed) & bit) continue;
+                    if (atomic_fetch_or_explicit(w, bit, memory_order_relaxed) & bit) continue;
+                    if (st->level) st->level[v] = depth;
+                    local_push(mine, v);
+                }
+            }
+        }
+        pthread_barrier_wait(&st->barrier);
+        // 2) thread 0 calcula onde cada buffer local entra no próximo nível
+        if (arg->tid == 0) {
+            int pos = st->hi;
+            for (int t = 0; t < st->nthreads; ++t) {
+                st->local[t].offset = pos;
+                pos += st->local[t].size;
+            }
+            st->lo = st->hi;
+            st->hi = pos;
+            st->depth = depth;
+            atomic_store_explicit(&st->cursor, 0, memory_order_relaxed);
+        }
+        pthread_barrier_wait(&st->barrier);
+        // 3) cada thread copia seu buffer em paralelo
+        if (mine->size > 0)
+            memcpy(st->order + mine->offset, mine->data, sizeof(int) * (size_t)mine->size);
+        mine->size = 0;
+        pthread_barrier_wait(&st->barrier);
+    }
+    return NULL;
+}
+
+/* Número de threads padrão: processadores disponíveis */
+int default_thread_count(void) {
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? (int)n : 1;
+}
+
+/* BFS paralela sobre o CSR com nthreads threads (0 = todos os processadores).
+   Mesmo contrato de bfs() e level opcional como csr_bfs_do(); conjunto
+   alcançado e níveis são idênticos aos da versão sequencial, a ordem dentro
+   de cada nível depende do escalonamento. Retorna visitados ou -1 em erro. */
+int csr_bfs_parallel(CSRGraph *c, int start, int *visited_order, int max_out, int *level, int nthreads) {
+    if (start < 0 || start >= c->n) return 0;
+    if (nthreads <= 0) nthreads = default_thread_count();
+    int n = c->n;
+    size_t words = ((size_t)n + 63) / 64;
+    ParBFS st;
+    st.c = c;
+    st.visited = calloc(words, sizeof(uint64_t));
+    st.order = malloc(sizeof(int) * (size_t)n);
+    st.local = calloc((size_t)nthreads, sizeof(LocalFrontier));
+    pthread_t *th = malloc(sizeof(pthread_t) * (size_t)nthreads);
+    ParBFSArg *args = malloc(sizeof(ParBFSArg) * (size_t)nthreads);
+    if (!st.visited || !st.order || !st.local || !th || !args) {
+        free((void*)st.visited); free(st.order); free(st.local); free(th); free(args);
+        return -1;
+    }
+    st.level = level;
+    if (level) for (int i = 0; i < n; ++i) level[i] = -1;
+    st.visited[start >> 6] = 1ULL << (start & 63);
+    if (level) level[start] = 0;
+    st.order[0] = start;
+    st.lo = 0;
+    st.hi = 1;
+    st.depth = 0;
+    atomic_init(&st.cursor, 0);
+    st.nthreads = nthreads;
+    pthread_barrier_init(&st.barrier, NULL, (unsigned)nthreads);
+
+    // a thread chamadora trabalha como thread 0
+    for (int t = 0; t < nthreads; ++t) {
+        args[t].st = &st;
+        args[t].tid = t;
+    }
+    for (int t = 1; t < nthreads; ++t) {
+        if (pthread_create(&th[t], NULL, par_bfs_worker, &args[t]) != 0) {
+            fprintf(stderr, "Erro: não foi possível criar thread.\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+    par_bfs_worker(&args[0]);
+    for (int t = 1; t < nthreads; ++t) pthread_join(th[t], NULL);
+
+    int count = st.hi;
+    memcpy(visited_order, st.order, sizeof(int) * (size_t)(count < max_out ? count : max_out));
+    pthread_barrier_destroy(&st.barrier);
+    for (int t = 0; t < nthreads; ++t) free(st.local[t].data);
+    free((void*)st.visited);
+    free(st.order);
+    free(st.local);
+    free(th);
+    free(args);
+    return count;
+}
+
+/* ----- Componentes conexas (Afforest paralelo sobre o CSR) ----- */
+
+typedef struct {
+    CSRGraph *c;
+    _Atomic int *comp;          // rótulo de cada vértice (floresta de ponteiros)
+    atomic_int cursor[2 * CC_NEIGHBOR_ROUNDS + 2]; // um distribuidor por fase
+    int frequent;               // rótulo da maior componente amostrada
+    int nthreads;
+    pthread_barrier_t barrier;
+} ParCC;
+
+typedef struct {
+    ParCC *st;
+    int tid;
+} ParCCArg;
+
+/* Liga as árvores de u e v: a raiz maior passa a apontar para a menor (CAS) */
+static void cc_link(_Atomic int *comp, int u, int v) {
+    int p1 = atomic_load_explicit(&comp[u], memory_order_relaxed);
+    int p2 = atomic_load_explicit(&comp[v], memory_order_relaxed);
+    while (p1 != p2) {
+        int high = p1 > p2 ? p1 : p2, low = p1 + p2 - high;
+        int p_high = atomic_load_explicit(&comp[high], memory_order_relaxed);
+        if (p_high == low) break;
+        if (p_high == high) {
+            int expected = high;
+            if (atomic_compare_exchange_strong_explicit(&comp[high], &expected, low,
+                                                        memory_order_relaxed, memory_order_relaxed))
+                break;
+        }
+        p1 = atomic_load_explicit(&comp[atomic_load_explicit(&comp[high], memory_order_relaxed)], memory_order_relaxed);
+        p2 = atomic_load_explicit(&comp[low], memory_order_relaxed);
+    }
+}
+
+/* Próximo pedaço [*lo, *hi) da fase; retorna 0 quando acabou */
+static int cc_next_chunk(ParCC *st, int phase, int *lo, int *hi) {
+    int i = atomic_fetch_add_explicit(&st->cursor[phase], CC_CHUNK, memory_order_relaxed);
+    if (i >= st->c->n) return 0;
+    *lo = i;
+    *hi = i + CC_CHUNK < st->c->n ? i + CC_CHUNK : st->c->n;
+    return 1;
+}
+
+/* Aponta cada vértice do pedaço direto para a raiz */
+static void cc_compress(ParCC *st, int phase) {
+    _Atomic int *comp = st->comp;
+    int lo, hi;
+    while (cc_next_chunk(st, phase, &lo, &hi))
+        for (int u = lo; u < hi; ++u) {
+            int p = atomic_load_explicit(&comp[u], memory_order_relaxed);
+            int pp = atomic_load_explicit(&comp[p], memory_order_relaxed);
+            while (p != pp) {
+                atomic_store_explicit(&comp[u], pp, memory_order_relaxed);
+                p = pp;
+                pp = atomic_load_explicit(&comp[p], memory_order_relaxed);
+            }
+        }
+}
+
+static void *par_cc_worker(void *p) {
+    ParCCArg *arg = p;
+    ParCC *st = arg->st;
+    CSRGraph *c = st->c;
+    int lo, hi, phase = 0;
+    // 1) rodadas de amostragem: só o r-ésimo vizinho de cada vértice
+    for (int r = 0; r < CC_NEIGHBOR_ROUNDS; ++r) {
+        while (cc_next_chunk(st, phase, &lo, &hi))
+            for (int u = lo; u < hi; ++u)
+                if (c->offsets[u] + r < c->offsets[u + 1]) cc_link(st->comp, u, c->nbrs[c->offsets[u] + r]);
+        phase++;
+        pthread_barrier_wait(&st->barrier);
+        cc_compress(st, phase++);
+        pthread_barrier_wait(&st->barrier);
+    }
+    // 2) thread 0 estima a maior componente por amostragem (semente fixa)
+    if (arg->tid == 0) {
+        int *sample = malloc(sizeof(int) * CC_SAMPLES);
+        st->frequent = 0;
+        if (sample) {
+            uint32_t x = 2463534242u;
+            for (int i = 0; i < CC_SAMPLES; ++i) {
+                x ^= x << 13; x ^= x >> 17; x ^= x << 5;
+                sample[i] = atomic_load_explicit(&st->comp[x % (uint32_t)c->n], memory_order_relaxed);
+            }
+            qsort(sample, CC_SAMPLES, sizeof(int), cmp_int);
+            int best = 0;
+            for (int i = 0, j; i < CC_SAMPLES; i = j) {
+                for (j = i; j < CC_SAMPLES && sample[j] == sample[i]; ++j) {}
+                if (j - i > best) { best = j - i; st->frequent = sample[i]; }
+            }
+            free(sample);
+        }
+    }
+    pthread_barrier_wait(&st->barrier);
+    // 3) vizinhos restantes, pulando quem já está na maior componente
+    while (cc_next_chunk(st, phase, &lo, &hi))
+        for (int u = lo; u < hi; ++u) {
+            if (atomic_load_explicit(&st->comp[u], memory_order_relaxed) == st->frequent) continue;
+            for (int k = c->offsets[u] + CC_NEIGHBOR_ROUNDS; k < c->offsets[u + 1]; ++k)
+                cc_link(st->comp, u, c->nbrs[k]);
+        }
+    phase++;
+    pthread_barrier_wait(&st->barrier);
+    cc_compress(st, phase);
+    return NULL;
+}
+
+/* Componentes conexas do CSR com nthreads threads (0 = todos os processadores).
+   comp[u] recebe o menor índice da componente de u (resultado determinístico,
+   independente do escalonamento). Retorna o número de componentes ou -1. */
+int csr_components_parallel(CSRGraph *c, int *comp, int nthreads) {
+    int n = c->n;
+    if (n == 0) return 0;
+    if (nthreads <= 0) nthreads = default_thread_count();
+    ParCC st;
+    st.c = c;
+    st.comp = malloc(sizeof(_Atomic int) * (size_t)n);
+    pthread_t *th = malloc(sizeof(pthread_t) * (size_t)nthreads);
+    ParCCArg *args = malloc(sizeof(ParCCArg) * (size_t)nthreads);
+    if (!st.comp || !th || !args) {
+        free((void*)st.comp); free(th); free(args);
+        return -1;
+    }
+    for (int u = 0; u < n; ++u) atomic_init(&st.comp[u], u);
+    for (size_t i = 0; i < sizeof(st.cursor) / sizeof(st.cursor[0]); ++i) atomic_init(&st.cursor[i], 0);
+    st.nthreads = nthreads;
+    pthread_barrier_init(&st.barrier, NULL, (unsigned)nthreads);
+
+    for (int t = 0; t < nthreads; ++t) {
+        args[t].st = &st;
+        args[t].tid = t;
+    }
+    for (int t = 1; t < nthreads; ++t) {
+        if (pthread_create(&th[t], NULL, par_cc_worker, &args[t]) != 0) {
+            fprintf(stderr, "Erro: não foi possível criar thread.\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+    par_cc_worker(&args[0]);
+    for (int t = 1; t < nthreads; ++t) pthread_join(th[t], NULL);
+
+    int count = 0;
+    for (int u = 0; u < n; ++u) {
+        comp[u] = atomic_load_explicit(&st.comp[u], memory_order_relaxed);
+        if (comp[u] == u) count++;
+    }
+    pthread_barrier_destroy(&st.barrier);
+    free((void*)st.comp);
+    free(th);
+    free(args);
+    return count;
+}
+
+/* Recalcula o union-find a partir do grafo atual (após remoções).
+   Retorna 0 sucesso, -1 sem memória. */
+int graph_components_rebuild(Graph *g, int nthreads) {
+    UnionFind *uf = &g->uf;
+    if (uf_reserve(uf, g->n) != 0) return -1;
+    CSRGraph c;
+    if (freeze_graph(g, &c, 0) != 0) return -1;
+    int count = csr_components_parallel(&c, uf->parent, nthreads);
+    csr_free(&c);
+    if (count < 0) return -1;
+    // comp[u] já aponta para a raiz: só falta recontar os tamanhos
+    for (int u = 0; u < g->n; ++u) uf->size[u] = 0;
+    for (int u = 0; u < g->n; ++u) uf->size[uf->parent[u]]++;
+    uf->count = count;
+    uf->dirty = 0;
+    return 0;
+}
+
+/* Recalcula só se houve remoções desde a última vez */
+static int components_refresh(Graph *g) {
+    return g->uf.dirty ? graph_components_rebuild(g, 0) : 0;
+}
+
+/* Representante da componente de u (-1 se inválido ou sem memória) */
+int component_of(Graph *g, int u) {
+    if (u < 0 || u >= g->n || components_refresh(g) != 0) return -1;
+    return uf_find(&g->uf, u);
+}
+
+/* Tamanho da componente de u (-1 se inválido) */
+int component_size(Graph *g, int u) {
+    int r = component_of(g, u);
+    return r == -1 ? -1 : g->uf.size[r];
+}
+
+/* Número de componentes conexas (-1 sem memória) */
+int component_count(Graph *g) {
+    return components_refresh(g) == 0 ? g->uf.count : -1;
+}
+
+/* 1 se u e v estão na mesma componente, 0 se não, -1 se inválido */
+int connected_by_index(Graph *g, int u, int v) {
+    int a = component_of(g, u), b = component_of(g, v);
+    if (a == -1 || b == -1) return -1;
+    return a == b;
+}
+
+int connected(Graph *g, const char *name1, const char *name2) {
+    return connected_by_index(g, find_vertex_index(g, name1), find_vertex_index(g, name2));
+}
+
+/* ----- Amigos em comum e triângulos (CSR ordenado) ----- */
+
+/* |a ∩ b| para vetores ordenados de tamanhos parecidos (merge sem desvios) */
+static int intersect_count_merge(const int *a, int na, const int *b, int nb) {
+    int i = 0, j = 0, count = 0;
+    while (i < na && j < nb) {
+        int x = a[i], y = b[j];
+        count += x == y;
+        i += x <= y;
+        j += y <= x;
+    }
+    return count;
+}
+
+/* Primeira posição >= key em a[lo..n): salto exponencial a partir de lo,
+   busca binária até sobrar uma janela de 8 e, com AVX2, a janela é resolvida
+   por uma comparação vetorial (conta quantos elementos são < key) */
+static int gallop_lower_bound(const int *a, int lo, int n, int key) {
+    int hi = lo, step = 1;
+    while (hi < n && a[hi] < key) {
+        lo = hi + 1;
+        hi += step;
+        step <<= 1;
+    }
+    if (hi > n) hi = n;
+    while (hi - lo > 8) {
+        int mid = lo + (hi - lo) / 2;
+        if (a[mid] < key) lo = mid + 1;
+        else hi = mid;
+    }
+#if defined(__AVX2__)
+    if (lo + 8 <= n) {
+        __m256i x = _mm256_loadu_si256((const __m256i*)(a + lo));
+        __m256i lt = _mm256_cmpgt_epi32(_mm256_set1_epi32(key), x);
+        return lo + popcount64((uint64_t)(unsigned)_mm256_movemask_ps(_mm256_castsi256_ps(lt)));
+    }
+#endif
+    while (lo < hi && a[lo] < key) lo++;
+    return lo;
+}
+
+/* |small ∩ large| com galope em large (O(ns log(nl / ns))) */
+static int intersect_count_gallop(const int *small, int ns, const int *large, int nl) {
+    int j = 0, count = 0;
+    for (int i = 0; i < ns && j < nl; ++i) {
+        j = gallop_lower_bound(large, j, nl, small[i]);
+        if (j < nl && large[j] == small[i]) { count++; j++; }
+    }
+    return count;
+}
+
+/* |a ∩ b|, escolhendo merge ou galope conforme a diferença de tamanhos */
+int intersect_count(const int *a, int na, const int *b, int nb) {
+    if (na > nb) { const int *t = a; a = b; b = t; int tn = na; na = nb; nb = tn; }
+    if (na == 0) return 0;
+    if (nb > GALLOP_RATIO * na) return intersect_count_gallop(a, na, b, nb);
+    return intersect_count_merge(a, na, b, nb);
+}
+
+/* Número de amigos em comum de u e v (CSR precisa estar ordenado); -1 se inválido */
+int csr_common_count(CSRGraph *c, int u, int v) {
+    if (!c->sorted || u < 0 || v < 0 || u >= c->n || v >= c->n) return -1;
+    return intersect_count(c->nbrs + c->offsets[u], csr_degree(c, u),
+                           c->nbrs + c->offsets[v], csr_degree(c, v));
+}
+
+/* Lista os amigos em comum de u e v em out (ordenados). Retorna quantos
+   existem (pode ser > max_out) ou -1 se inválido */
+int csr_common_neighbors(CSRGraph *c, int u, int v, int *out, int max_out) {
+    if (!c->sorted || u < 0 || v < 0 || u >= c->n || v >= c->n) return -1;
+    const int *a = c->nbrs + c->offsets[u], *b = c->nbrs + c->offsets[v];
+    int na = csr_degree(c, u), nb = csr_degree(c, v);
+    int i = 0, j = 0, count = 0;
+    while (i < na && j < nb) {
+        if (a[i] < b[j]) i++;
+        else if (a[i] > b[j]) j++;
+        else {
+            if (count < max_out) out[count] = a[i];
+            count++;
+            i++;
+            j++;
+        }
+    }
+    return count;
+}
+
+typedef struct {
+    CSRGraph *c;                // grafo (ou arestas orientadas, para o total)
+    long long *per_vertex;      // triângulos por vértice (opcional)
+    long long *partial;         // soma parcial de cada thread
+    atomic_int cursor;
+} ParTri;
+
+typedef struct {
+    ParTri *st;
+    int tid;
+} ParTriArg;
+
+static void *par_tri_worker(void *p) {
+    ParTriArg *arg = p;
+    ParTri *st = arg->st;
+    CSRGraph *c = st->c;
+    long long sum = 0;
+    while (1) {
+        int lo = atomic_fetch_add_explicit(&st->cursor, TRI_CHUNK, memory_order_relaxed);
+        if (lo >= c->n) break;
+        int hi = lo + TRI_CHUNK < c->n ? lo + TRI_CHUNK : c->n;
+        for (int u = lo; u < hi; ++u) {
+            const int *nu = c->nbrs + c->offsets[u];
+            int du = csr_degree(c, u);
+            long long t = 0;
+            for (int k = 0; k < du; ++k) {
+                int v = nu[k];
+                t += intersect_count(nu, du, c->nbrs + c->offsets[v], csr_degree(c, v));
+            }
+            // grafo completo: cada triângulo de u aparece duas vezes (v e w)
+            if (st->per_vertex) st->per_vertex[u] = t / 2;
+            sum += t;
+        }
+    }
+    st->partial[arg->tid] = sum;
+    return NULL;
+}
+
+/* Executa par_tri_worker em nthreads threads e soma as parciais */
+static long long run_par_tri(ParTri *st, int nthreads) {
+    pthread_t *th = malloc(sizeof(pthread_t) * (size_t)nthreads);
+    ParTriArg *args = malloc(sizeof(ParTriArg) * (size_t)nthreads);
+    st->partial = calloc((size_t)nthreads, sizeof(long long));
+    if (!th || !args || !st->partial) { free(th); free(args); free(st->partial); return -1; }
+    atomic_init(&st->cursor, 0);
+    for (int t = 0; t < nthreads; ++t) {
+        args[t].st = st;
+        args[t].tid = t;
+    }
+    for (int t = 1; t < nthreads; ++t) {
+        if (pthread_create(&th[t], NULL, par_tri_worker, &args[t]) != 0) {
+            fprintf(stderr, "Erro: não foi possível criar thread.\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+    par_tri_worker(&args[0]);
+    for (int t = 1; t < nthreads; ++t) pthread_join(th[t], NULL);
+    long long total = 0;
+    for (int t = 0; t < nthreads; ++t) total += st->partial[t];
+    free(st->partial);
+    free(th);
+    free(args);
+    return total;
+}
+
+/* Conta triângulos do CSR ordenado com nthreads threads (0 = todos os processadores).
+   Sem per_vertex, orienta cada aresta do vértice de menor grau para o de maior
+   grau (desempate pelo índice): cada triângulo é contado uma vez e as listas
+   dos vértices populares encolhem. Com per_vertex (n posições), usa as listas
+   completas e grava os triângulos de cada vértice. Retorna o total ou -1. */
+long long csr_triangle_count(CSRGraph *c, long long *per_vertex, int nthreads) {
+    if (!c->sorted) return -1;
+    if (nthreads <= 0) nthreads = default_thread_count();
+    ParTri st;
+    st.per_vertex = per_vertex;
+    if (per_vertex) {
+        st.c = c;
+        long long t = run_par_tri(&st, nthreads);
+        return t < 0 ? -1 : t / 6;
+    }
+    // arestas orientadas: subsequências das listas ordenadas continuam ordenadas
+    CSRGraph dag;
+    dag.n = c->n;
+    dag.sorted = 1;
+    dag.weights = NULL;
+    dag.offsets = malloc(sizeof(int) * ((size_t)c->n + 1));
+    dag.nbrs = malloc(sizeof(int) * (c->m2 / 2 > 0 ? (size_t)c->m2 / 2 : 1));
+    if (!dag.offsets || !dag.nbrs) { csr_free(&dag); return -1; }
+    int k = 0;
+    for (int u = 0; u < c->n; ++u) {
+        dag.offsets[u] = k;
+        int du = csr_degree(c, u);
+        for (int e = c->offsets[u]; e < c->offsets[u + 1]; ++e) {
+            int v = c->nbrs[e], dv = csr_degree(c, v);
+            if (dv > du || (dv == du && v > u)) dag.nbrs[k++] = v;
+        }
+    }
+    dag.offsets[c->n] = k;
+    dag.m2 = k;
+    st.c = &dag;
+    long long t = run_par_tri(&st, nthreads);
+    csr_free(&dag);
+    return t;
+}
+
+/* Coeficiente de agrupamento local: triângulos / pares de amigos */
+double clustering_coefficient(int degree, long long triangles) {
+    if (degree < 2) return 0.0;
+    return 2.0 * (double)triangles / ((double)degree * (double)(degree - 1));
+}
+
+/* ----- CSR comprimido (diferenças + varint) ----- */
+
+/* Vizinhos ordenados de u em data[offsets[u] .. offsets[u+1]) como varints
+   (7 bits por byte, bit alto = continua): grau, primeiro vizinho em zigzag
+   relativo a u, depois as diferenças entre vizinhos consecutivos (>= 1).
+   Com vizinhos próximos no índice (ver graph_reorder) a maioria das
+   diferenças cabe em 1 byte, contra 4 do CSR e 16 do AdjNode. */
+typedef struct {
+    int n;
+    long long m2;           // meias-arestas
+    size_t *offsets;        // n + 1 posições (bytes)
+    uint8_t *data;
+    size_t bytes;           // tamanho usado de data
+} CompressedCSR;
+
+/* Leitor sequencial dos vizinhos de um vértice (decodifica um à frente) */
+typedef struct {
+    const uint8_t *p;
+    int left;               // vizinhos ainda não devolvidos
+    int cur;                // próximo vizinho a devolver
+} ZIter;
+
+static inline uint32_t varint_read(const uint8_t **pp) {
+    const uint8_t *p = *pp;
+    uint32_t x = *p++;
+    if (x >= 0x80) { // caminho raro: mais de um byte
+        x &= 0x7F;
+        for (int shift = 7; ; shift += 7) {
+            uint32_t b = *p++;
+            x |= (b & 0x7F) << shift;
+            if (b < 0x80) break;
+        }
+    }
+    *pp = p;
+    return x;
+}
+
+static inline uint8_t *varint_write(uint8_t *p, uint32_t x) {
+    while (x >= 0x80) {
+        *p++ = (uint8_t)(x | 0x80);
+        x >>= 7;
+    }
+    *p++ = (uint8_t)x;
+    return p;
+}
+
+/* Posiciona it nos vizinhos de u; retorna o grau */
+static inline int zcsr_begin(const CompressedCSR *z, int u, ZIter *it) {
+    it->p = z->data + z->offsets[u];
+    it->left = (int)varint_read(&it->p);
+    it->cur = u;
+    if (it->left > 0) {
+        uint32_t x = varint_read(&it->p);
+        it->cur = u + ((int)(x >> 1) ^ -(int)(x & 1)); // zigzag
+    }
+    return it->left;
+}
+
+/* Próximo vizinho (chamar só com it->left > 0) */
+static inline int zcsr_next(ZIter *it) {
+    int v = it->cur;
+    if (--it->left > 0) it->cur += (int)varint_read(&it->p);
+    return v;
+}
+
+/* Comprime as listas de g (sem passar pelo CSR: só um vetor de rascunho do
+   tamanho do maior grau). Retorna 0 sucesso, -1 sem memória. */
+int compress_graph(Graph *g, CompressedCSR *z) {
+    z->n = g->n;
+    z->m2 = 0;
+    z->data = NULL;
+    z->bytes = 0;
+    z->offsets = malloc(sizeof(size_t) * ((size_t)g->n + 1));
+    int *tmp = malloc(sizeof(int) * ((size_t)g->deg.max_degree + 1));
+    size_t cap = (size_t)g->n * 2 + 64;
+    uint8_t *data = malloc(cap);
+    if (!z->offsets || !tmp || !data) {
+        free(z->offsets); free(tmp); free(data);
+        z->offsets = NULL;
+        return -1;
+    }
+    size_t len = 0;
+    for (int u = 0; u < g->n; ++u) {
+        int d = 0;
+        for (AdjNode *curr = g->vertices[u].head; curr; curr = curr->next) tmp[d++] = curr->v;
+        qsort(tmp, (size_t)d, sizeof(int), cmp_int);
+        // pior caso: 5 bytes por varint
+        if (len + 5 * ((size_t)d + 1) > cap) {
+            while (len + 5 * ((size_t)d + 1) > cap) cap *= 2;
+            uint8_t *nd = realloc(data, cap);
+            if (!nd) { free(z->offsets); free(tmp); free(data); z->offsets = NULL; return -1; }
+            data = nd;
+        }
+        z->offsets[u] = len;
+        uint8_t *p = varint_write(data + len, (uint32_t)d);
+        int prev = u;
+        for (int i = 0; i < d; ++i) {
+            if (i == 0) {
+                int delta = tmp[0] - u;
+                p = varint_write(p, ((uint32_t)delta << 1) ^ (uint32_t)(delta >> 31));
+            } else {
+                p = varint_write(p, (uint32_t)(tmp[i] - prev));
+            }
+            prev = tmp[i];
+        }
+        len = (size_t)(p - data);
+        z->m2 += d;
+    }
+    z->offsets[g->n] = len;
+    free(tmp);
+    uint8_t *nd = realloc(data, len > 0 ? len : 1); // devolve a folga
+    z->data = nd ? nd : data;
+    z->bytes = len;
+    return 0;
+}
+
+void zcsr_free(CompressedCSR *z) {
+    free(z->offsets);
+    free(z->data);
+    z->offsets = NULL;
+    z->data = NULL;
+    z->n = 0;
+    z->m2 = 0;
+    z->bytes = 0;
+}
+
+/* Memória total (offsets + fluxo de bytes) */
+size_t zcsr_memory(const CompressedCSR *z) {
+    return sizeof(size_t) * ((size_t)z->n + 1) + z->bytes;
+}
+
+int zcsr_degree(const CompressedCSR *z, int u) {
+    if (u < 0 || u >= z->n) return -1;
+    const uint8_t *p = z->data + z->offsets[u];
+    return (int)varint_read(&p);
+}
+
+/* Decodifica os vizinhos de u (ordem crescente) em out; retorna o grau */
+int zcsr_neighbors(const CompressedCSR *z, int u, int *out) {
+    if (u < 0 || u >= z->n) return -1;
+    ZIter it;
+    int d = zcsr_begin(z, u, &it);
+    for (int i = 0; i < d; ++i) out[i] = zcsr_next(&it);
+    return d;
+}
+
+/* Aresta u-v: decodifica até passar de v (vizinhos ordenados) */
+int zcsr_has_edge(const CompressedCSR *z, int u, int v) {
+    if (u < 0 || u >= z->n) return 0;
+    ZIter it;
+    zcsr_begin(z, u, &it);
+    while (it.left > 0) {
+        int w = zcsr_next(&it);
+        if (w >= v) return w == v;
+    }
+    return 0;
+}
+
+/* BFS decodificando na hora (mesmo contrato de csr_bfs_ctx; a ordem de
+   visita é a do CSR ordenado) */
+int zcsr_bfs_ctx(const CompressedCSR *z, TraversalCtx *ctx, int start, int *visited_order, int max_out) {
+    if (start < 0 || start >= z->n) return 0;
+    if (traversal_ctx_begin(ctx, z->n) != 0) return 0;
+    int *queue = ctx->queue.data;
+    int head = 0, tail = 0;
+    ctx_mark(ctx, start);
+    queue[tail++] = start;
+    while (head < tail) {
+        ZIter it;
+        zcsr_begin(z, queue[head++], &it);
+        while (it.left > 0) {
+            int v = zcsr_next(&it);
+            if (!ctx_visited(ctx, v)) {
+                ctx_mark(ctx, v);
+                queue[tail++] = v;
+            }
+        }
+    }
+    int count = tail;
+    memcpy(visited_order, queue, sizeof(int) * (size_t)(count < max_out ? count : max_out));
+    return count;
+}
+
+/* Amigos em comum de u e v: merge dos dois fluxos sem descomprimir */
+int zcsr_common_count(const CompressedCSR *z, int u, int v) {
+    if (u < 0 || v < 0 || u >= z->n || v >= z->n) return -1;
+    ZIter a, b;
+    zcsr_begin(z, u, &a);
+    zcsr_begin(z, v, &b);
+    if (a.left == 0 || b.left == 0) return 0;
+    int x = zcsr_next(&a), y = zcsr_next(&b), count = 0;
+    for (;;) {
+        if (x < y) {
+            if (a.left == 0) break;
+            x = zcsr_next(&a);
+        } else if (y < x) {
+            if (b.left == 0) break;
+            y = zcsr_next(&b);
+        } else {
+            count++;
+            if (a.left == 0 || b.left == 0) break;
+            x = zcsr_next(&a);
+            y = zcsr_next(&b);
+        }
+    }
+    return count;
+}
+
+/* ----- Snapshot binário (gravação e carga por mmap) ----- */
+
+/* Layout do arquivo (ordem de bytes nativa, seções alinhadas em 8 bytes):
+   cabeçalho | deslocamentos dos nomes (n+1 int32) | nomes (terminados em \0)
+   | índice hash (index_cap NameSlot) | offsets CSR (n+1 int32) | vizinhos (m2 int32)
+   | pesos (m2 float, só com o bit 1 de flags; logo depois dos vizinhos)
+   | ids estáveis (n int32, versão 2). A versão 1 não tem os ids: na carga
+   eles viram 0..n-1. */
+#define SNAPSHOT_MAGIC "RSNAPv1"
+#define SNAPSHOT_VERSION 2u
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t flags;         // bit 0: vizinhos ordenados; bit 1: seção de pesos
+    int32_t n, m2;
+    int32_t names_bytes;
+    int32_t index_cap;
+    uint64_t off_name_off, off_names, off_index, off_offsets, off_nbrs;
+    uint64_t file_size;
+    // versão 2 em diante
+    int32_t next_id;        // próximo id a atribuir (ids removidos não voltam)
+    uint32_t wal_generation; // geração do log que continua este snapshot (modo durável)
+    uint64_t off_ids;
+} SnapshotHeader;
+
+#define SNAPSHOT_V1_HEADER_SIZE offsetof(SnapshotHeader, next_id)
+
+/* Grafo somente leitura apontando para dentro do arquivo mapeado */
+typedef struct {
+    void *base;             // região mapeada
+    size_t size;
+    CSRGraph csr;           // offsets/nbrs/weights dentro do mapeamento (não chamar csr_free)
+    const int32_t *name_off;
+    const char *names;
+    const NameSlot *slots;  // índice hash gravado junto
+    int index_cap;
+    const int32_t *ids;     // id estável de cada vértice (NULL na versão 1: id = índice)
+    int next_id;
+    uint32_t wal_generation;
+} GraphSnapshot;
+
+static uint64_t align8(uint64_t x) { return (x + 7) & ~(uint64_t)7; }
+
+/* Início da seção de pesos (não há campo no cabeçalho: versões antigas continuam válidas) */
+static uint64_t snapshot_off_weights(const SnapshotHeader *h) {
+    return h->off_nbrs + align8(sizeof(int32_t) * (uint64_t)h->m2);
+}
+
+/* Completa com zeros até o alinhamento de 8 (len = bytes já escritos na seção) */
+static int write_pad(FILE *f, uint64_t len) {
+    static const char zeros[8] = {0};
+    uint64_t pad = align8(len) - len;
+    return (pad && fwrite(zeros, 1, (size_t)pad, f) != pad) ? -1 : 0;
+}
+
+/* Escreve len bytes seguidos do preenchimento */
+static int write_padded(FILE *f, const void *data, uint64_t len) {
+    if (len && fwrite(data, 1, (size_t)len, f) != len) return -1;
+    return write_pad(f, len);
+}
+
+/* Grava g em filename marcando a geração do log que o continua
+   (retorna 0 sucesso, -1 erro) */
+static int save_snapshot_generation(Graph *g, const char *filename, uint32_t wal_generation) {
+    // a arena compactada já é a seção de nomes: grava de uma vez só
+    if (name_arena_compact(g) != 0) return -1;
+    if (g->names.len > INT_MAX) return -1;
+    long long nb = (long long)g->names.len;
+    CSRGraph c;
+    if (freeze_graph(g, &c, 1) != 0) return -1;
+    int32_t *name_off = malloc(sizeof(int32_t) * ((size_t)g->n + 1));
+    if (!name_off) { csr_free(&c); return -1; }
+    int32_t *ids = malloc(sizeof(int32_t) * ((size_t)g->n + 1));
+    if (!ids) { free(name_off); csr_free(&c); return -1; }
+    for (int i = 0; i < g->n; ++i) {
+        name_off[i] = (int32_t)g->vertices[i].name_off;
+        ids[i] = g->vertices[i].id;
+    }
+    name_off[g->n] = (int32_t)nb;
+
+    SnapshotHeader h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+    h.version = SNAPSHOT_VERSION;
+    h.flags = 1;
+    h.n = g->n;
+    h.m2 = c.m2;
+    h.names_bytes = (int32_t)nb;
+    h.index_cap = g->index.cap;
+    h.off_name_off = align8(sizeof(h));
+    h.off_names = h.off_name_off + align8(sizeof(int32_t) * ((uint64_t)g->n + 1));
+    h.off_index = h.off_names + align8((uint64_t)nb);
+    h.off_offsets = h.off_index + align8(sizeof(NameSlot) * (uint64_t)g->index.cap);
+    h.off_nbrs = h.off_offsets + align8(sizeof(int32_t) * ((uint64_t)g->n + 1));
+    h.file_size = snapshot_off_weights(&h);
+    if (c.weights) {
+        h.flags |= 2;
+        h.file_size += align8(sizeof(float) * (uint64_t)c.m2);
+    }
+    h.next_id = g->next_id;
+    h.wal_generation = wal_generation;
+    h.off_ids = h.file_size;
+    h.file_size += align8(sizeof(int32_t) * (uint64_t)g->n);
+
+    int r = -1;
+    FILE *f = fopen(filename, "wb");
+    if (f) {
+        setvbuf(f, NULL, _IOFBF, 1 << 20);
+        r = 0;
+        r |= write_padded(f, &h, sizeof(h));
+        r |= write_padded(f, name_off, sizeof(int32_t) * ((uint64_t)g->n + 1));
+        if (nb > 0 && fwrite(g->names.data, 1, (size_t)nb, f) != (size_t)nb) r = -1;
+        r |= write_pad(f, (uint64_t)nb);
+        r |= write_padded(f, g->index.slots, sizeof(NameSlot) * (uint64_t)g->index.cap);
+        r |= write_padded(f, c.offsets, sizeof(int32_t) * ((uint64_t)g->n + 1));
+        r |= write_padded(f, c.nbrs, sizeof(int32_t) * (uint64_t)c.m2);
+        if (c.weights) r |= write_padded(f, c.weights, sizeof(float) * (uint64_t)c.m2);
+        r |= write_padded(f, ids, sizeof(int32_t) * (uint64_t)g->n);
+        if (fclose(f) != 0) r = -1;
+    }
+    free(name_off);
+    free(ids);
+    csr_free(&c);
+    return r;
+}
+
+/* Grava g em filename (retorna 0 sucesso, -1 erro) */
+int save_snapshot(Graph *g, const char *filename) {
+    return save_snapshot_generation(g, filename, 0);
+}
+
+/* Confere se as seções do cabeçalho (hsize bytes no arquivo) estão em
+   ordem e cabem no arquivo */
+static int snapshot_header_valid(const SnapshotHeader *h, size_t hsize) {
+    if (h->n < 0 || h->m2 < 0 || h->names_bytes < 0 || h->index_cap < 0) return 0;
+    if (h->index_cap & (h->index_cap - 1)) return 0; // potência de 2 (ou 0)
+    if (h->index_cap == 0 && h->n > 0) return 0;
+    if (h->next_id < h->n) return 0;
+    uint64_t end = (h->flags & 2) ? snapshot_off_weights(h) + sizeof(float) * (uint64_t)h->m2
+                                  : h->off_nbrs + sizeof(int32_t) * (uint64_t)h->m2;
+    if (hsize == sizeof(SnapshotHeader)) {
+        if (h->off_ids < end) return 0;
+        end = h->off_ids + sizeof(int32_t) * (uint64_t)h->n;
+    }
+    return h->off_name_off >= hsize &&
+           h->off_names >= h->off_name_off + sizeof(int32_t) * ((uint64_t)h->n + 1) &&
+           h->off_index >= h->off_names + (uint64_t)h->names_bytes &&
+           h->off_offsets >= h->off_index + sizeof(NameSlot) * (uint64_t)h->index_cap &&
+           h->off_nbrs >= h->off_offsets + sizeof(int32_t) * ((uint64_t)h->n + 1) &&
+           h->file_size >= end;
+}
+
+/* Confere o conteúdo das seções já mapeadas, em O(V + E) sequencial:
+   deslocamentos dos nomes crescentes com cada nome terminado no seu \0,
+   offsets CSR crescentes de 0 a m2, vizinhos e slots do índice em [0, n)
+   (com pelo menos um slot vazio), pesos finitos >= 0 e ids em [0, next_id). Sem isso um arquivo corrompido vira acesso fora
+   do mapeamento nos percursos ou em graph_from_snapshot. */
+static int snapshot_contents_valid(const GraphSnapshot *snap, const SnapshotHeader *h) {
+    const CSRGraph *c = &snap->csr;
+    int n = h->n;
+    if (snap->name_off[0] != 0 || snap->name_off[n] != h->names_bytes) return 0;
+    for (int i = 0; i < n; ++i) {
+        int32_t a = snap->name_off[i], b = snap->name_off[i + 1];
+        if (b <= a || snap->names[b - 1] != '\0') return 0;
+        if (memchr(snap->names + a, '\0', (size_t)(b - a - 1))) return 0; // um nome por faixa
+    }
+    if (c->offsets[0] != 0 || c->offsets[n] != h->m2) return 0;
+    for (int u = 0; u < n; ++u)
+        if (c->offsets[u + 1] < c->offsets[u]) return 0;
+    for (int k = 0; k < h->m2; ++k)
+        if (c->nbrs[k] < 0 || c->nbrs[k] >= n) return 0;
+    if (c->weights)
+        for (int k = 0; k < h->m2; ++k)
+            if (!(c->weights[k] >= 0.0f) || c->weights[k] > FLT_MAX) return 0;
+    int empty = 0;
+    for (int i = 0; i < h->index_cap; ++i) {
+        if (snap->slots[i].idx < -1 || snap->slots[i].idx >= n) return 0;
+        empty += snap->slots[i].idx == -1;
+    }
+    // sem slot vazio a sondagem de um nome ausente não teria onde parar
+    if (h->index_cap > 0 && empty == 0) return 0;
+    if (snap->ids)
+        for (int i = 0; i < n; ++i)
+            if (snap->ids[i] < 0 || snap->ids[i] >= h->next_id) return 0;
+    return 1;
+}
+
+/* Mapeia filename somente leitura e valida cabeçalho e conteúdo (retorna 0
+   sucesso, -1 erro). Nada é copiado: os percursos csr_* rodam direto sobre
+   as páginas mapeadas. */
+int load_snapshot(const char *filename, GraphSnapshot *snap) {
+    memset(snap, 0, sizeof(*snap));
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) return -1;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < SNAPSHOT_V1_HEADER_SIZE) { close(fd); return -1; }
+    void *base = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) return -1;
+    // cópia local: na versão 1 os campos novos não existem no arquivo
+    SnapshotHeader hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    memcpy(&hdr, base, SNAPSHOT_V1_HEADER_SIZE);
+    size_t hsize = hdr.version == 1 ? SNAPSHOT_V1_HEADER_SIZE : sizeof(SnapshotHeader);
+    if (hdr.version == SNAPSHOT_VERSION && (size_t)st.st_size >= hsize) memcpy(&hdr, base, hsize);
+    else hdr.next_id = hdr.n;
+    const SnapshotHeader *h = &hdr;
+    if (memcmp(h->magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) != 0 ||
+        (h->version != 1 && h->version != SNAPSHOT_VERSION) ||
+        h->file_size != (uint64_t)st.st_size || !snapshot_header_valid(h, hsize)) {
+        munmap(base, (size_t)st.st_size);
+        return -1;
+    }
+    const char *b = base;
+    snap->base = base;
+    snap->size = (size_t)st.st_size;
+    snap->name_off = (const int32_t*)(b + h->off_name_off);
+    snap->names = b + h->off_names;
+    snap->slots = (const NameSlot*)(b + h->off_index);
+    snap->index_cap = h->index_cap;
+    snap->csr.n = h->n;
+    snap->csr.m2 = h->m2;
+    snap->csr.offsets = (int*)(b + h->off_offsets);
+    snap->csr.nbrs = (int*)(b + h->off_nbrs);
+    snap->csr.weights = (h->flags & 2) ? (float*)(b + snapshot_off_weights(h)) : NULL;
+    snap->csr.sorted = (h->flags & 1) != 0;
+    snap->ids = h->version >= 2 ? (const int32_t*)(b + h->off_ids) : NULL;
+    snap->next_id = h->next_id;
+    snap->wal_generation = h->wal_generation;
+    if (!snapshot_contents_valid(snap, h)) {
+        munmap(base, snap->size);
+        memset(snap, 0, sizeof(*snap));
+        return -1;
+    }
+    // aviso ao kernel: acesso aleatório nos percursos
+    madvise(base, snap->size, MADV_RANDOM);
+    return 0;
+}
+
+void snapshot_close(GraphSnapshot *snap) {
+    if (snap->base) munmap(snap->base, snap->size);
+    memset(snap, 0, sizeof(*snap));
+}
+
+/* Nome do vértice i do snapshot */
+const char *snapshot_name(const GraphSnapshot *snap, int i) {
+    if (i < 0 || i >= snap->csr.n) return NULL;
+    return snap->names + snap->name_off[i];
+}
+
+/* Busca por nome usando o índice hash gravado no arquivo; -1 se não existe */
+int snapshot_find(const GraphSnapshot *snap, const char *name) {
+    if (snap->index_cap == 0) return -1;
+    uint32_t h = hash_name(name);
+    int mask = snap->index_cap - 1;
+    int i = (int)(h & (uint32_t)mask);
+    for (int step = 0; step < snap->index_cap; ++step, i = (i + 1) & mask) {
+        const NameSlot *s = &snap->slots[i];
+        if (s->idx == -1) return -1;
+        if (s->hash == h && strcmp(snapshot_name(snap, s->idx), name) == 0) return s->idx;
+    }
+    return -1;
+}
+
+/* Reconstrói um grafo mutável (g recém-inicializado) a partir do snapshot,
+   com os mesmos ids estáveis (retorna 0 sucesso, -1 sem memória ou id repetido) */
+int graph_from_snapshot(Graph *g, const GraphSnapshot *snap) {
+    const CSRGraph *c = &snap->csr;
+    if (graph_reserve(g, c->n) != 0) return -1;
+    for (int i = 0; i < c->n; ++i)
+        if (add_vertex(g, snapshot_name(snap, i)) != 0) return -1;
+    if (snap->ids) {
+        // add_vertex numerou 0..n-1; troca pelos ids gravados
+        if (snap->next_id > g->id_cap) {
+            int *nm = realloc(g->id_to_index, sizeof(int) * (size_t)snap->next_id);
+            if (!nm) return -1;
+            g->id_to_index = nm;
+            g->id_cap = snap->next_id;
+        }
+        for (int id = 0; id < snap->next_id; ++id) g->id_to_index[id] = -1;
+        for (int i = 0; i < c->n; ++i) {
+            int id = snap->ids[i];
+            if (g->id_to_index[id] != -1) return -1;
+            g->id_to_index[id] = i;
+            g->vertices[i].id = id;
+        }
+        g->next_id = snap->next_id;
+    }
+    // cada aresta aparece duas vezes no CSR; o lote descarta a repetição
+    int *pairs = malloc(sizeof(int) * 2 * (size_t)(c->m2 > 0 ? c->m2 : 1));
+    if (!pairs) return -1;
+    size_t m = 0;
+    for (int u = 0; u < c->n; ++u)
+        for (int k = c->offsets[u]; k < c->offsets[u + 1]; ++k)
+            if (u < c->nbrs[k]) {
+                pairs[2 * m] = u;
+                pairs[2 * m + 1] = c->nbrs[k];
+                m++;
+            }
+    long long r = add_edges_batch(g, pairs, m);
+    free(pairs);
+    if (r < 0) return -1;
+    if (c->weights)
+        for (int u = 0; u < c->n; ++u)
+            for (int k = c->offsets[u]; k < c->offsets[u + 1]; ++k)
+                if (u < c->nbrs[k] && c->weights[k] != 1.0f)
+                    set_edge_weight_by_index(g, u, c->nbrs[k], c->weights[k]);
+    return 0;
+}
+
+/* ----- Importação de lista de arestas (CSV/TSV) ----- */
+
+#define IMPORT_BUF_SIZE (4 << 20)       // bytes lidos por vez
+#define IMPORT_BATCH_PAIRS (1 << 20)    // pares acumulados antes de add_edges_batch
+
+typedef struct {
+    long long lines;            // linhas lidas
+    long long edges_read;       // linhas com dois campos
+    long long edges_added;      // arestas novas inseridas
+    long long vertices_added;   // pessoas criadas durante a importação
+    double seconds;
+} ImportStats;
+
+static int is_field_delim(char c) { return c == ',' || c == '\t' || c == ' ' || c == ';'; }
+
+/* Índice do vértice com nome s[0..len), criando-o se não existir; -1 sem memória */
+static int intern_vertex(Graph *g, const char *s, size_t len, long long *created) {
+    // hash calculado uma vez; o nome vai direto do buffer de leitura para a arena
+    uint32_t h = hash_name_len(s, len);
+    int slot = name_index_find_slot(g, s, len, h);
+    if (slot != -1) return g->index.slots[slot].idx;
+    if (add_vertex_hashed(g, s, len, h) != 0) return -1;
+    (*created)++;
+    return g->n - 1;
+}
+
+/* Processa uma linha [p, end): "nome1<sep>nome2[<sep>...]" com sep em , ; TAB ou espaço.
+   Linhas vazias e comentários (# ou %) são ignorados. Retorna 1 se gerou um par. */
+static int parse_edge_line(Graph *g, const char *p, const char *end, int *pair, ImportStats *st) {
+    while (p < end && is_field_delim(*p)) p++;
+    if (p == end || *p == '#' || *p == '%') return 0;
+    const char *a = p;
+    while (p < end && !is_field_delim(*p)) p++;
+    const char *a_end = p;
+    while (p < end && is_field_delim(*p)) p++;
+    const char *b = p;
+    while (p < end && !is_field_delim(*p)) p++;
+    if (b == p) return 0;
+    pair[0] = intern_vertex(g, a, (size_t)(a_end - a), &st->vertices_added);
+    pair[1] = intern_vertex(g, b, (size_t)(p - b), &st->vertices_added);
+    if (pair[0] < 0 || pair[1] < 0) return -1;
+    st->edges_read++;
+    return 1;
+}
+
+/* Lê f em blocos de IMPORT_BUF_SIZE e chama fn(arg, início, fim) para cada
+   linha, sem o \n, tokenizando no próprio buffer (sem cópia por linha).
+   Para no primeiro retorno negativo de fn. Retorna 0 sucesso, -1 erro. */
+static int read_lines(FILE *f, int (*fn)(void *arg, const char *p, const char *end), void *arg) {
+    char *buf = malloc(IMPORT_BUF_SIZE);
+    if (!buf) return -1;
+    size_t have = 0;
+    int r = 0, eof = 0;
+    while (!eof && r == 0) {
+        size_t got = fread(buf + have, 1, IMPORT_BUF_SIZE - have, f);
+        if (got == 0) eof = 1;
+        have += got;
+        char *p = buf, *end = buf + have;
+        while (r == 0) {
+            char *nl = memchr(p, '\n', (size_t)(end - p));
+            if (!nl) {
+                if (!eof) break;
+                if (p == end) break;
+                nl = end; // última linha sem \n
+            }
+            const char *le = nl;
+            if (le > p && le[-1] == '\r') le--;
+            if (fn(arg, p, le) < 0) r = -1;
+            p = nl < end ? nl + 1 : end;
+        }
+        // linha incompleta vai para o início do buffer
+        have = (size_t)(end - p);
+        if (have == IMPORT_BUF_SIZE) r = -1; // linha maior que o buffer
+        memmove(buf, p, have);
+    }
+    if (r == 0 && ferror(f)) r = -1;
+    free(buf);
+    return r;
+}
+
+typedef struct {
+    Graph *g;
+    ImportStats *st;
+    int *pairs;
+    size_t npairs;
+} ImportState;
+
+static int import_flush(ImportState *is) {
+    if (is->npairs == 0) return 0;
+    long long added = add_edges_batch(is->g, is->pairs, is->npairs);
+    is->npairs = 0;
+    if (added < 0) return -1;
+    is->st->edges_added += added;
+    return 0;
+}
+
+static int import_line(void *arg, const char *p, const char *end) {
+    ImportState *is = arg;
+    is->st->lines++;
+    int k = parse_edge_line(is->g, p, end, &is->pairs[2 * is->npairs], is->st);
+    if (k < 0) return -1;
+    if (k > 0 && ++is->npairs == IMPORT_BATCH_PAIRS) return import_flush(is);
+    return 0;
+}
+
+/* Importa arestas de filename ("-" = entrada padrão) em blocos grandes,
+   tokenizando no próprio buffer e inserindo em lotes via add_edges_batch.
+   Pessoas desconhecidas são criadas. Retorna 0 sucesso, -1 erro. */
+int import_edge_list(Graph *g, const char *filename, ImportStats *st) {
+    memset(st, 0, sizeof(*st));
+    double t0 = now_seconds();
+    FILE *f = strcmp(filename, "-") == 0 ? stdin : fopen(filename, "rb");
+    if (!f) return -1;
+    ImportState is = { g, st, malloc(sizeof(int) * 2 * IMPORT_BATCH_PAIRS), 0 };
+    int r = -1;
+    if (is.pairs) {
+        r = read_lines(f, import_line, &is);
+        if (r == 0) r = import_flush(&is);
+    }
+    free(is.pairs);
+    if (f != stdin) fclose(f);
+    st->seconds = now_seconds() - t0;
+    return r;
+}
+
+/* Resumo da importação com taxa de arestas por segundo */
+void print_import_stats(const ImportStats *st) {
+    double rate = st->seconds > 0 ? (double)st->edges_read / st->seconds : 0.0;
+    printf("Importação: %lld linhas, %lld arestas lidas, %lld novas, %lld pessoas criadas\n",
+           st->lines, st->edges_read, st->edges_added, st->vertices_added);
+    printf("Tempo: %.3f s (%.0f arestas/s)\n", st->seconds, rate);
+}
+
+/* ----- Grafo de exemplo (pré-definido) ----- */
+void insert_sample_graph(Graph *g) {
+    // nomes simples
+    const char *names[] = {"Alice", "Bob", "Carol", "Dave", "Eve", "Frank"};
+    int cnt = sizeof(names)/sizeof(names[0]);
+    for (int i = 0; i < cnt; ++i) add_vertex(g, names[i]);
+    add_edge(g, "Alice", "Bob");
+    add_edge(g, "Alice", "Carol");
+    add_edge(g, "Bob", "Dave");
+    add_edge(g, "Carol", "Eve");
+    add_edge(g, "Eve", "Frank");
+    add_edge(g, "Bob", "Carol");
+    add_edge(g, "Dave", "Frank");
+    printf("Grafo de exemplo inserido (%d vértices).\n", g->n);
+}
+
+/* ----- Limpeza final ----- */
+void free_graph(Graph *g) {
+    for (int i = 0; i < g->n; ++i) {
+        hub_drop(&g->vertices[i]);
+        g->vertices[i].head = NULL;
+    }
+    // nomes vivem na arena e nós no pool: só os conjuntos hash são por vértice
+    name_arena_free(&g->names);
+    // todos os nós vivem no pool: libera bloco a bloco, sem percorrer listas
+    adj_pool_release(&g->pool);
+    graph_disable_bitmatrix(g);
+    free(g->vertices);
+    g->vertices = NULL;
+    name_index_free(&g->index);
+    uf_free(&g->uf);
+    deg_free(&g->deg);
+    free(g->id_to_index);
+    g->id_to_index = NULL;
+    g->id_cap = 0;
+    g->next_id = 0;
+    g->n = 0;
+    g->cap = 0;
+}
+
+/* ----- Leitura concorrente (versões imutáveis estilo RCU) ----- */
+
+/* Versão publicada: adj[u] aponta para um bloco imutável {grau, vizinhos...}
+   (NULL = grau 0) e names[u] para o nome do vértice u, com o id estável em
+   ids[u]. Blocos de vértices que não mudaram são compartilhados com a
+   versão anterior; o nome é compartilhado enquanto o mesmo id ocupa o
+   índice (a remoção rápida move o último vértice para outro índice). */
+typedef struct {
+    int n;
+    int **adj;
+    char **names;
+    int *ids;
+    uint64_t number;            // número da versão (cresce a cada publicação)
+} GraphVersion;
+
+/* Lixo de uma publicação: a versão substituída e os blocos que deixaram de
+   ser usados; liberado quando todos os leitores ativos têm época >= epoch */
+typedef struct Retired {
+    GraphVersion *version;
+    void **blocks;              // blocos de vizinhos e nomes
+    int nblocks;
+    uint64_t epoch;
+    struct Retired *next;
+} Retired;
+
+/* Época anunciada por um leitor (0 = fora de leitura); uma linha de cache por leitor */
+typedef struct {
+    _Atomic uint64_t epoch;
+    atomic_int used;
+    char pad[64 - sizeof(uint64_t) - sizeof(int)];
+} ReaderSlot;
+
+typedef struct {
+    Graph g;                        // estado mutável: só escritores, sob writer
+    pthread_mutex_t writer;
+    unsigned char *dirty;           // vértices alterados desde a última publicação
+    int dirty_cap;
+    _Atomic(GraphVersion *) current;
+    _Atomic uint64_t global_epoch;
+    ReaderSlot readers[RCU_MAX_READERS];
+    Retired *retired;               // mais recente primeiro
+} ConcurrentGraph;
+
+static void version_free(GraphVersion *ver) {
+    if (!ver) return;
+    free(ver->adj);
+    free(ver->names);
+    free(ver->ids);
+    free(ver);
+}
+
+/* Inicia com uma versão vazia publicada (retorna 0 sucesso, -1 sem memória) */
+int cgraph_init(ConcurrentGraph *cg) {
+    init_graph(&cg->g);
+    pthread_mutex_init(&cg->writer, NULL);
+    cg->dirty = NULL;
+    cg->dirty_cap = 0;
+    cg->retired = NULL;
+    atomic_init(&cg->global_epoch, 1);
+    for (int i = 0; i < RCU_MAX_READERS; ++i) {
+        atomic_init(&cg->readers[i].epoch, 0);
+        atomic_init(&cg->readers[i].used, 0);
+    }
+    GraphVersion *ver = calloc(1, sizeof(GraphVersion));
+    if (!ver) return -1;
+    atomic_init(&cg->current, ver);
+    return 0;
+}
+
+/* ---- Leitores ---- */
+
+/* Reserva um slot de leitor para a thread; -1 se todos estão ocupados */
+int cgraph_reader_register(ConcurrentGraph *cg) {
+    for (int i = 0; i < RCU_MAX_READERS; ++i) {
+        int expected = 0;
+        if (atomic_compare_exchange_strong(&cg->readers[i].used, &expected, 1)) return i;
+    }
+    return -1;
+}
+
+void cgraph_reader_unregister(ConcurrentGraph *cg, int slot) {
+    atomic_store(&cg->readers[slot].epoch, 0);
+    atomic_store(&cg->readers[slot].used, 0);
+}
+
+/* Anuncia a época e pega a versão atual; a versão vale até cgraph_read_end.
+   Sem trava e sem espera: nunca bloqueia nem é bloqueado pelo escritor. */
+const GraphVersion *cgraph_read_begin(ConcurrentGraph *cg, int slot) {
+    atomic_store(&cg->readers[slot].epoch, atomic_load(&cg->global_epoch));
+    return atomic_load(&cg->current);
+}
+
+void cgraph_read_end(ConcurrentGraph *cg, int slot) {
+    atomic_store_explicit(&cg->readers[slot].epoch, 0, memory_order_release);
+}
+
+static inline int version_degree(const GraphVersion *ver, int u) {
+    return ver->adj[u] ? ver->adj[u][0] : 0;
+}
+
+/* Nome e id estável do vértice u da versão (válidos até cgraph_read_end) */
+const char *version_name(const GraphVersion *ver, int u) {
+    return u >= 0 && u < ver->n ? ver->names[u] : NULL;
+}
+
+int version_id(const GraphVersion *ver, int u) {
+    return u >= 0 && u < ver->n ? ver->ids[u] : -1;
+}
+
+/* BFS sobre uma versão (mesmo contrato de csr_bfs_ctx) */
+int version_bfs(const GraphVersion *ver, TraversalCtx *ctx, int start, int *visited_order, int max_out) {
+    if (start < 0 || start >= ver->n) return 0;
+    if (traversal_ctx_begin(ctx, ver->n) != 0) return 0;
+    int *queue = ctx->queue.data;
+    int head = 0, tail = 0;
+    ctx_mark(ctx, start);
+    queue[tail++] = start;
+    while (head < tail) {
+        const int *blk = ver->adj[queue[head++]];
+        if (!blk) continue;
+        for (int k = 1; k <= blk[0]; ++k) {
+            int v = blk[k];
+            if (!ctx_visited(ctx, v)) {
+                ctx_mark(ctx, v);
+                queue[tail++] = v;
+            }
+        }
+    }
+    int count = tail;
+    memcpy(visited_order, queue, sizeof(int) * (size_t)(count < max_out ? count : max_out));
+    return count;
+}
+
+/* DFS sobre uma versão (mesmo contrato de csr_dfs_ctx) */
+int version_dfs(const GraphVersion *ver, TraversalCtx *ctx, int start, int *order, int max_out) {
+    if (start < 0 || start >= ver->n) return 0;
+    if (traversal_ctx_begin(ctx, ver->n) != 0) return 0;
+    int *stack = ctx->queue.data;
+    int *cursor = ctx->cursor;
+    int top = 0, pos = 0;
+    ctx_mark(ctx, start);
+    if (pos < max_out) order[pos] = start;
+    pos++;
+    stack[0] = start;
+    cursor[0] = 1;
+    while (top >= 0) {
+        const int *blk = ver->adj[stack[top]];
+        if (!blk || cursor[top] > blk[0]) { top--; continue; }
+        int v = blk[cursor[top]++];
+        if (ctx_visited(ctx, v)) continue;
+        ctx_mark(ctx, v);
+        if (pos < max_out) order[pos] = v;
+        pos++;
+        ++top;
+        stack[top] = v;
+        cursor[top] = 1;
+    }
+    return pos;
+}
+
+/* ---- Escritores (serializados por cg->writer) ---- */
+
+static int cgraph_mark(ConcurrentGraph *cg, int u) {
+    if (u >= cg->dirty_cap) {
+        int ncap = cg->dirty_cap ? cg->dirty_cap : MIN_VERTEX_CAP;
+        while (ncap <= u) ncap *= 2;
+        unsigned char *nd = realloc(cg->dirty, (size_t)ncap);
+        if (!nd) return -1;
+        memset(nd + cg->dirty_cap, 0, (size_t)(ncap - cg->dirty_cap));
+        cg->dirty = nd;
+        cg->dirty_cap = ncap;
+    }
+    cg->dirty[u] = 1;
+    return 0;
+}
+
+/* As mutações valem para a próxima versão publicada (cgraph_publish) */
+int cgraph_add_vertex(ConcurrentGraph *cg, const char *name) {
+    pthread_mutex_lock(&cg->writer);
+    int r = cgraph_mark(cg, cg->g.n) == 0 ? add_vertex(&cg->g, name) : -1;
+    pthread_mutex_unlock(&cg->writer);
+    return r;
+}
+
+int cgraph_add_edge(ConcurrentGraph *cg, const char *name1, const char *name2) {
+    pthread_mutex_lock(&cg->writer);
+    int u = find_vertex_index(&cg->g, name1), v = find_vertex_index(&cg->g, name2);
+    int r = -1;
+    if (u != -1 && v != -1 && cgraph_mark(cg, u) == 0 && cgraph_mark(cg, v) == 0)
+        r = add_edge_by_index(&cg->g, u, v);
+    pthread_mutex_unlock(&cg->writer);
+    return r;
+}
+
+int cgraph_remove_edge(ConcurrentGraph *cg, const char *name1, const char *name2) {
+    pthread_mutex_lock(&cg->writer);
+    int u = find_vertex_index(&cg->g, name1), v = find_vertex_index(&cg->g, name2);
+    int r = -1;
+    if (u != -1 && v != -1 && cgraph_mark(cg, u) == 0 && cgraph_mark(cg, v) == 0)
+        r = remove_edge_by_index(&cg->g, u, v);
+    pthread_mutex_unlock(&cg->writer);
+    return r;
+}
+
+/* Remoção rápida: mudam target, o último vértice e os vizinhos de ambos */
+int cgraph_remove_vertex(ConcurrentGraph *cg, const char *name) {
+    pthread_mutex_lock(&cg->writer);
+    Graph *g = &cg->g;
+    int t = find_vertex_index(g, name), r = -1;
+    if (t != -1) {
+        int last = g->n - 1, ok = cgraph_mark(cg, t) == 0 && cgraph_mark(cg, last) == 0;
+        for (AdjNode *c = g->vertices[t].head; ok && c; c = c->next) ok = cgraph_mark(cg, c->v) == 0;
+        for (AdjNode *c = g->vertices[last].head; ok && c; c = c->next) ok = cgraph_mark(cg, c->v) == 0;
+        if (ok) r = remove_vertex_fast_by_index(g, t);
+    }
+    pthread_mutex_unlock(&cg->writer);
+    return r;
+}
+
+/* Bloco imutável com os vizinhos atuais de u (NULL se grau 0 ou sem memória, em *err) */
+static int *cgraph_build_block(Graph *g, int u, int *err) {
+    int d = g->vertices[u].degree;
+    if (d == 0) return NULL;
+    int *blk = malloc(sizeof(int) * ((size_t)d + 1));
+    if (!blk) { *err = 1; return NULL; }
+    blk[0] = d;
+    int k = 1;
+    for (AdjNode *c = g->vertices[u].head; c; c = c->next) blk[k++] = c->v;
+    return blk;
+}
+
+/* Libera o lixo que nenhum leitor ativo pode estar usando */
+static void cgraph_reclaim(ConcurrentGraph *cg) {
+    uint64_t min_active = UINT64_MAX;
+    for (int i = 0; i < RCU_MAX_READERS; ++i) {
+        uint64_t e = atomic_load(&cg->readers[i].epoch);
+        if (e != 0 && e < min_active) min_active = e;
+    }
+    Retired **pp = &cg->retired;
+    while (*pp) {
+        Retired *rt = *pp;
+        if (rt->epoch <= min_active) {
+            *pp = rt->next;
+            for (int i = 0; i < rt->nblocks; ++i) free(rt->blocks[i]);
+            free(rt->blocks);
+            version_free(rt->version);
+            free(rt);
+        } else {
+            pp = &rt->next;
+        }
+    }
+}
+
+/* Cópia imutável do nome do vértice u (NULL sem memória) */
+static char *cgraph_build_name(Graph *g, int u) {
+    size_t len = g->vertices[u].name_len;
+    char *name = malloc(len + 1);
+    if (name) memcpy(name, vertex_name(g, u), len + 1);
+    return name;
+}
+
+/* Publica as mutações acumuladas como nova versão: copia os vetores de
+   ponteiros (O(V)) e só reconstrói os blocos dos vértices alterados e os
+   nomes dos índices que passaram a outro vértice. A versão antiga e os
+   blocos substituídos vão para a lista de espera por época.
+   Retorna 0 sucesso, -1 sem memória (a versão atual continua valendo). */
+int cgraph_publish(ConcurrentGraph *cg) {
+    pthread_mutex_lock(&cg->writer);
+    Graph *g = &cg->g;
+    GraphVersion *old = atomic_load(&cg->current);
+    GraphVersion *ver = malloc(sizeof(GraphVersion));
+    Retired *rt = malloc(sizeof(Retired));
+    size_t n = (size_t)(g->n > 0 ? g->n : 1);
+    void **blocks = malloc(sizeof(void*) * (2 * (size_t)old->n + 1));
+    int **adj = malloc(sizeof(int*) * n);
+    char **names = malloc(sizeof(char*) * n);
+    int *ids = malloc(sizeof(int) * n);
+    if (!ver || !rt || !blocks || !adj || !names || !ids) {
+        free(ver); free(rt); free(blocks); free(adj); free(names); free(ids);
+        pthread_mutex_unlock(&cg->writer);
+        return -1;
+    }
+    int err = 0, nb = 0;
+    for (int u = 0; u < g->n; ++u) {
+        int changed = u >= old->n || (u < cg->dirty_cap && cg->dirty[u]);
+        int same = u < old->n && old->ids[u] == g->vertices[u].id;
+        adj[u] = changed ? cgraph_build_block(g, u, &err) : old->adj[u];
+        names[u] = same ? old->names[u] : cgraph_build_name(g, u);
+        if (!names[u]) err = 1;
+        ids[u] = g->vertices[u].id;
+    }
+    if (err) {
+        for (int u = 0; u < g->n; ++u) {
+            if (u >= old->n || (u < cg->dirty_cap && cg->dirty[u])) free(adj[u]);
+            if (u >= old->n || old->ids[u] != ids[u]) free(names[u]);
+        }
+        free(ver); free(rt); free(blocks); free(adj); free(names); free(ids);
+        pthread_mutex_unlock(&cg->writer);
+        return -1;
+    }
+    for (int u = 0; u < old->n; ++u) {
+        if ((u >= g->n || (u < cg->dirty_cap && cg->dirty[u])) && old->adj[u]) blocks[nb++] = old->adj[u];
+        if (u >= g->n || old->ids[u] != ids[u]) blocks[nb++] = old->names[u];
+    }
+    if (cg->dirty) memset(cg->dirty, 0, (size_t)cg->dirty_cap);
+    ver->n = g->n;
+    ver->adj = adj;
+    ver->names = names;
+    ver->ids = ids;
+    ver->number = old->number + 1;
+
+    // troca a versão e avança a época: quem anunciar a nova época vê a nova versão
+    atomic_store(&cg->current, ver);
+    rt->version = old;
+    rt->blocks = blocks;
+    rt->nblocks = nb;
+    rt->epoch = atomic_fetch_add(&cg->global_epoch, 1) + 1;
+    rt->next = cg->retired;
+    cg->retired = rt;
+    cgraph_reclaim(cg);
+    pthread_mutex_unlock(&cg->writer);
+    return 0;
+}
+
+/* Libera tudo; nenhum leitor pode estar ativo */
+void cgraph_free(ConcurrentGraph *cg) {
+    GraphVersion *ver = atomic_load(&cg->current);
+    for (int u = 0; u < ver->n; ++u) {
+        free(ver->adj[u]);
+        free(ver->names[u]);
+    }
+    version_free(ver);
+    atomic_store(&cg->current, NULL);
+    cgraph_reclaim(cg);
+    free_graph(&cg->g);
+    free(cg->dirty);
+    cg->dirty = NULL;
+    cg->dirty_cap = 0;
+    pthread_mutex_destroy(&cg->writer);
+}
+
+/* ----- Grafo particionado (shards com vértices fantasmas) ----- */
+
+/* Cada shard é um Graph comum com os vértices que possui e um fantasma para
+   cada vizinho de outro shard: uma aresta entre shards aparece nos dois,
+   ligando o vértice próprio ao fantasma. O dono de uma pessoa é
+   hash(nome) % nshards, calculável em qualquer nó sem diretório central.
+   Os fantasmas guardam o id estável do vértice no shard dono (ids não mudam
+   com remoções), que é o que trafega nas mensagens. */
+typedef struct {
+    Graph g;
+    int *owner;             // por id: shard dono (-1 = próprio)
+    int *remote;            // por id: id do vértice no shard dono (fantasmas)
+    int id_cap;
+    TraversalCtx ctx;       // BFS: marcas, fronteira (queue) e nível (parent)
+    LocalFrontier *out;     // uma caixa de saída por shard de destino
+    long long messages, ids_sent;
+    int lo, hi;             // nível atual em ctx.queue.data[lo, hi)
+} Shard;
+
+typedef struct {
+    int nshards;
+    Shard *shards;
+    int *frontier;          // tamanho da próxima fronteira de cada shard
+    pthread_barrier_t barrier;
+} ShardedGraph;
+
+typedef struct {
+    long long reached;      // vértices alcançados (sem contar fantasmas)
+    int depth;              // níveis percorridos
+    long long messages;     // mensagens em lote (origem -> destino não vazias por nível)
+    long long ids_sent;     // ids de vértices enviados nas mensagens
+} ShardBFSStats;
+
+void sharded_free(ShardedGraph *sg) {
+    for (int s = 0; s < sg->nshards; ++s) {
+        Shard *sh = &sg->shards[s];
+        free_graph(&sh->g);
+        free(sh->owner);
+        free(sh->remote);
+        traversal_ctx_free(&sh->ctx);
+        if (sh->out)
+            for (int t = 0; t < sg->nshards; ++t) free(sh->out[t].data);
+        free(sh->out);
+    }
+    free(sg->shards);
+    free(sg->frontier);
+    sg->shards = NULL;
+    sg->frontier = NULL;
+    sg->nshards = 0;
+}
+
+/* Retorna 0 sucesso, -1 sem memória (nada fica alocado) */
+int sharded_init(ShardedGraph *sg, int nshards) {
+    sg->nshards = nshards;
+    sg->shards = calloc((size_t)nshards, sizeof(Shard));
+    sg->frontier = calloc((size_t)nshards, sizeof(int));
+    if (!sg->shards || !sg->frontier) {
+        free(sg->shards);
+        free(sg->frontier);
+        sg->shards = NULL;
+        sg->frontier = NULL;
+        sg->nshards = 0;
+        return -1;
+    }
+    for (int s = 0; s < nshards; ++s) {
+        init_graph(&sg->shards[s].g);
+        traversal_ctx_init(&sg->shards[s].ctx);
+    }
+    for (int s = 0; s < nshards; ++s) {
+        sg->shards[s].out = calloc((size_t)nshards, sizeof(LocalFrontier));
+        if (!sg->shards[s].out) { sharded_free(sg); return -1; }
+    }
+    return 0;
+}
+
+static inline int shard_of(const ShardedGraph *sg, const char *name, size_t len) {
+    return (int)(hash_name_len(name, len) % (uint32_t)sg->nshards);
+}
+
+static inline int shard_is_ghost(const Shard *sh, int i) {
+    return sh->owner[sh->g.vertices[i].id] != -1;
+}
+
+/* Registra o último vértice inserido no shard (dono e id remoto) */
+static int shard_note_vertex(Shard *sh, int owner, int remote) {
+    int id = sh->g.vertices[sh->g.n - 1].id;
+    if (id >= sh->id_cap) {
+        int ncap = sh->id_cap ? sh->id_cap * 2 : MIN_VERTEX_CAP;
+        while (ncap <= id) ncap *= 2;
+        int *no = realloc(sh->owner, sizeof(int) * (size_t)ncap);
+        if (!no) return -1;
+        sh->owner = no;
+        int *nr = realloc(sh->remote, sizeof(int) * (size_t)ncap);
+        if (!nr) return -1;
+        sh->remote = nr;
+        sh->id_cap = ncap;
+    }
+    sh->owner[id] = owner;
+    sh->remote[id] = remote;
+    return 0;
+}
+
+/* Adiciona pessoa no shard dono (retorna 0 sucesso, -1 sem memória, -2 se já existe) */
+int sharded_add_vertex(ShardedGraph *sg, const char *name) {
+    size_t len = strlen(name);
+    Shard *sh = &sg->shards[shard_of(sg, name, len)];
+    // fantasmas nunca ficam no shard dono, então um nome achado aqui é a própria pessoa
+    if (find_vertex_index_len(&sh->g, name, len) != -1) return -2;
+    int r = add_vertex_len(&sh->g, name, len);
+    if (r != 0) return r;
+    return shard_note_vertex(sh, -1, -1);
+}
+
+/* Índice do vértice próprio com esse nome no seu shard (*shard recebe o dono); -1 se não existe */
+static int sharded_find(ShardedGraph *sg, const char *name, int *shard) {
+    size_t len = strlen(name);
+    *shard = shard_of(sg, name, len);
+    return find_vertex_index_len(&sg->shards[*shard].g, name, len);
+}
+
+/* Fantasma de (vértice ub do shard sb) dentro do shard sa, criado se preciso; -1 sem memória */
+static int shard_ghost(ShardedGraph *sg, int sa, int sb, int ub) {
+    Shard *a = &sg->shards[sa], *b = &sg->shards[sb];
+    const Vertex *vb = &b->g.vertices[ub];
+    const char *name = vertex_name(&b->g, ub);
+    int i = find_vertex_index_len(&a->g, name, vb->name_len);
+    if (i != -1) return i;
+    if (add_vertex_len(&a->g, name, vb->name_len) != 0) return -1;
+    if (shard_note_vertex(a, sb, vb->id) != 0) return -1;
+    return a->g.n - 1;
+}
+
+/* Liga ua (shard sa) a ub (shard sb): no mesmo shard é uma aresta comum;
+   entre shards, cada lado liga o vértice próprio ao fantasma do outro.
+   Retorna 0 sucesso, -1 se já existe ou sem memória. */
+static int sharded_link(ShardedGraph *sg, int sa, int ua, int sb, int ub) {
+    if (sa == sb) return add_edge_by_index(&sg->shards[sa].g, ua, ub);
+    int gb = shard_ghost(sg, sa, sb, ub);
+    int ga = gb < 0 ? -1 : shard_ghost(sg, sb, sa, ua);
+    if (ga < 0) return -1;
+    if (add_edge_by_index(&sg->shards[sa].g, ua, gb) != 0) return -1;
+    return add_edge_by_index(&sg->shards[sb].g, ub, ga);
+}
+
+/* Amizade entre pessoas existentes (retorna 0 sucesso, -1 erro) */
+int sharded_add_edge(ShardedGraph *sg, const char *name1, const char *name2) {
+    int sa, sb;
+    int ua = sharded_find(sg, name1, &sa), ub = sharded_find(sg, name2, &sb);
+    if (ua == -1 || ub == -1) return -1;
+    return sharded_link(sg, sa, ua, sb, ub);
+}
+
+/* Remove o fantasma i do shard se ficou sem arestas */
+static void shard_drop_ghost(Shard *sh, int i) {
+    if (i != -1 && sh->g.vertices[i].degree == 0) remove_vertex_fast_by_index(&sh->g, i);
+}
+
+/* Retira a aresta entre o próprio ua e o fantasma gb do shard sa */
+static int shard_unlink_ghost(Shard *sh, int ua, int gb) {
+    if (remove_edge_by_index(&sh->g, ua, gb) != 0) return -1;
+    shard_drop_ghost(sh, gb);
+    return 0;
+}
+
+int sharded_remove_edge(ShardedGraph *sg, const char *name1, const char *name2) {
+    int sa, sb;
+    int ua = sharded_find(sg, name1, &sa), ub = sharded_find(sg, name2, &sb);
+    if (ua == -1 || ub == -1) return -1;
+    if (sa == sb) return remove_edge_by_index(&sg->shards[sa].g, ua, ub);
+    Shard *a = &sg->shards[sa], *b = &sg->shards[sb];
+    int gb = find_vertex_index(&a->g, name2), ga = find_vertex_index(&b->g, name1);
+    if (ga == -1 || gb == -1) return -1;
+    // fantasmas saem por remoção rápida: buscar ua/ub de novo pelo id depois
+    int id_b = b->g.vertices[ub].id;
+    if (shard_unlink_ghost(a, ua, gb) != 0) return -1;
+    return shard_unlink_ghost(b, vertex_index_by_id(&b->g, id_b), ga);
+}
+
+/* Remove a pessoa do shard dono e o seu fantasma dos shards vizinhos */
+int sharded_remove_vertex(ShardedGraph *sg, const char *name) {
+    int sa;
+    int ua = sharded_find(sg, name, &sa);
+    if (ua == -1) return -1;
+    Shard *a = &sg->shards[sa];
+    int *ghost_ids = malloc(sizeof(int) * ((size_t)a->g.vertices[ua].degree + 1));
+    if (!ghost_ids) return -1;
+    int ng = 0, id_a = a->g.vertices[ua].id;
+    for (AdjNode *curr = a->g.vertices[ua].head; curr; curr = curr->next)
+        if (shard_is_ghost(a, curr->v)) ghost_ids[ng++] = a->g.vertices[curr->v].id;
+    for (int k = 0; k < ng; ++k) {
+        Shard *b = &sg->shards[a->owner[ghost_ids[k]]];
+        int ub = vertex_index_by_id(&b->g, a->remote[ghost_ids[k]]);
+        int ga = find_vertex_index(&b->g, name);
+        if (ub != -1 && ga != -1) shard_unlink_ghost(b, ub, ga);
+    }
+    remove_vertex_fast_by_index(&a->g, vertex_index_by_id(&a->g, id_a));
+    for (int k = 0; k < ng; ++k) shard_drop_ghost(a, vertex_index_by_id(&a->g, ghost_ids[k]));
+    free(ghost_ids);
+    return 0;
+}
+
+/* Particiona g em nshards (sg recém-inicializado com sharded_init): cria os
+   vértices próprios, depois os fantasmas, e insere as arestas de cada shard
+   com add_edges_batch para manter as listas contíguas.
+   Retorna 0 sucesso, -1 sem memória. */
+int sharded_from_graph(ShardedGraph *sg, Graph *g) {
+    int ns = sg->nshards;
+    int *shard = malloc(sizeof(int) * ((size_t)g->n + 1));
+    int *local = malloc(sizeof(int) * ((size_t)g->n + 1));
+    LocalFrontier *pairs = calloc((size_t)ns, sizeof(LocalFrontier));
+    if (!shard || !local || !pairs) { free(shard); free(local); free(pairs); return -1; }
+    int r = 0;
+    for (int u = 0; u < g->n && r == 0; ++u) {
+        shard[u] = shard_of(sg, vertex_name(g, u), g->vertices[u].name_len);
+        Shard *sh = &sg->shards[shard[u]];
+        local[u] = sh->g.n;
+        if (add_vertex_len(&sh->g, vertex_name(g, u), g->vertices[u].name_len) != 0 ||
+            shard_note_vertex(sh, -1, -1) != 0) r = -1;
+    }
+    for (int u = 0; u < g->n && r == 0; ++u)
+        for (AdjNode *curr = g->vertices[u].head; curr && r == 0; curr = curr->next) {
+            int v = curr->v, su = shard[u], sv = shard[v];
+            if (su == sv) {
+                if (u < v) {
+                    local_push(&pairs[su], local[u]);
+                    local_push(&pairs[su], local[v]);
+                }
+                continue;
+            }
+            // cada sentido da aresta entre shards vale para o lado de u
+            int gv = shard_ghost(sg, su, sv, local[v]);
+            if (gv < 0) { r = -1; break; }
+            local_push(&pairs[su], local[u]);
+            local_push(&pairs[su], gv);
+        }
+    for (int s = 0; s < ns; ++s) {
+        if (r == 0 && add_edges_batch(&sg->shards[s].g, pairs[s].data, (size_t)pairs[s].size / 2) < 0) r = -1;
+        free(pairs[s].data);
+    }
+    free(pairs);
+    free(shard);
+    free(local);
+    return r;
+}
+
+/* Arestas entre shards (cada uma liga um vértice próprio a um fantasma nos dois lados) */
+long long sharded_edge_cut(const ShardedGraph *sg) {
+    long long cut = 0;
+    for (int s = 0; s < sg->nshards; ++s) {
+        const Shard *sh = &sg->shards[s];
+        for (int i = 0; i < sh->g.n; ++i)
+            if (shard_is_ghost(sh, i)) cut += sh->g.vertices[i].degree;
+    }
+    return cut / 2;
+}
+
+typedef struct {
+    ShardedGraph *sg;
+    int tid;                // shard deste trabalhador
+} ShardBFSArg;
+
+/* Um trabalhador por shard (como um nó por máquina). Cada nível tem três
+   fases separadas por barreira: expandir a fronteira local (vizinhos
+   próprios entram na próxima fronteira, fantasmas viram ids na caixa de
+   saída do dono, uma vez por BFS), receber as caixas endereçadas a este
+   shard e, por fim, esvaziar as próprias caixas e publicar o tamanho da
+   fronteira; todos somam os tamanhos e param juntos quando é zero. */
+static void *shard_bfs_worker(void *p) {
+    ShardBFSArg *arg = p;
+    ShardedGraph *sg = arg->sg;
+    Shard *sh = &sg->shards[arg->tid];
+    TraversalCtx *ctx = &sh->ctx;
+    int *queue = ctx->queue.data, *level = ctx->parent;
+    int tail = sh->hi;
+    for (int depth = 1; ; ++depth) {
+        for (int i = sh->lo; i < sh->hi; ++i)
+            for (AdjNode *curr = sh->g.vertices[queue[i]].head; curr; curr = curr->next) {
+                int v = curr->v;
+                if (ctx_visited(ctx, v)) continue;
+                ctx_mark(ctx, v);
+                int id = sh->g.vertices[v].id;
+                if (sh->owner[id] == -1) {
+                    level[v] = depth;
+                    queue[tail++] = v;
+                } else {
+                    local_push(&sh->out[sh->owner[id]], sh->remote[id]);
+                }
+            }
+        pthread_barrier_wait(&sg->barrier);
+        for (int src = 0; src < sg->nshards; ++src) {
+            LocalFrontier *in = &sg->shards[src].out[arg->tid];
+            for (int k = 0; k < in->size; ++k) {
+                int v = vertex_index_by_id(&sh->g, in->data[k]);
+                if (v == -1 || ctx_visited(ctx, v)) continue;
+                ctx_mark(ctx, v);
+                level[v] = depth;
+                queue[tail++] = v;
+            }
+        }
+        pthread_barrier_wait(&sg->barrier);
+        for (int dst = 0; dst < sg->nshards; ++dst) {
+            if (sh->out[dst].size == 0) continue;
+            sh->messages++;
+            sh->ids_sent += sh->out[dst].size;
+            sh->out[dst].size = 0;
+        }
+        sh->lo = sh->hi;
+        sh->hi = tail;
+        sg->frontier[arg->tid] = tail - sh->lo;
+        pthread_barrier_wait(&sg->barrier);
+        long long active = 0;
+        for (int s = 0; s < sg->nshards; ++s) active += sg->frontier[s];
+        if (active == 0) break;
+    }
+    return NULL;
+}
+
+/* BFS síncrona por nível a partir da pessoa start, com uma thread por shard
+   trocando fronteiras em mensagens por lote. Níveis ficam em
+   shards[s].ctx.parent[i] para os vértices próprios marcados.
+   Retorna 0 sucesso, -1 se start não existe ou sem memória. */
+int sharded_bfs(ShardedGraph *sg, const char *start, ShardBFSStats *stats) {
+    memset(stats, 0, sizeof(*stats));
+    int s0;
+    int u0 = sharded_find(sg, start, &s0);
+    if (u0 == -1) return -1;
+    int ns = sg->nshards;
+    pthread_t *th = malloc(sizeof(pthread_t) * (size_t)ns);
+    ShardBFSArg *args = malloc(sizeof(ShardBFSArg) * (size_t)ns);
+    if (!th || !args) { free(th); free(args); return -1; }
+    for (int s = 0; s < ns; ++s) {
+        Shard *sh = &sg->shards[s];
+        if (traversal_ctx_begin(&sh->ctx, sh->g.n > 0 ? sh->g.n : 1) != 0) { free(th); free(args); return -1; }
+        sh->lo = sh->hi = 0;
+        sh->messages = sh->ids_sent = 0;
+        args[s].sg = sg;
+        args[s].tid = s;
+    }
+    Shard *first = &sg->shards[s0];
+    ctx_mark(&first->ctx, u0);
+    first->ctx.parent[u0] = 0;
+    first->ctx.queue.data[0] = u0;
+    first->hi = 1;
+    pthread_barrier_init(&sg->barrier, NULL, (unsigned)ns);
+    // a thread chamadora trabalha pelo shard 0
+    for (int s = 1; s < ns; ++s) {
+        if (pthread_create(&th[s], NULL, shard_bfs_worker, &args[s]) != 0) {
+            fprintf(stderr, "Erro: não foi possível criar thread.\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+    shard_bfs_worker(&args[0]);
+    for (int s = 1; s < ns; ++s) pthread_join(th[s], NULL);
+    pthread_barrier_destroy(&sg->barrier);
+    for (int s = 0; s < ns; ++s) {
+        Shard *sh = &sg->shards[s];
+        stats->reached += sh->hi;
+        stats->messages += sh->messages;
+        stats->ids_sent += sh->ids_sent;
+    }
+    free(th);
+    free(args);
+    // níveis com vértices: o último nível visitado + 1
+    int depth = 0;
+    for (int s = 0; s < ns; ++s) {
+        Shard *sh = &sg->shards[s];
+        for (int i = 0; i < sh->hi; ++i)
+            if (sh->ctx.parent[sh->ctx.queue.data[i]] + 1 > depth) depth = sh->ctx.parent[sh->ctx.queue.data[i]] + 1;
+    }
+    stats->depth = depth;
+    return 0;
+}
+
+/* ----- Log de escrita antecipada (WAL) ----- */
+
+/* Arquivo: cabeçalho (magic + versão + geração, uint32) e registros
+     tamanho (uint32) | crc32 do conteúdo (uint32) | conteúdo
+   conteúdo = operação (1 byte) | len a (uint32) | a | len b (uint32) | b
+   (em SET_WEIGHT, b = nome seguido do peso, float de 4 bytes)
+   Cada mutação é registrada antes de ser aplicada e os registros vão para o
+   disco em grupo (um write + fdatasync a cada WAL_GROUP_OPS registros ou no
+   commit explícito). Na recuperação, um registro truncado ou com crc errado
+   marca o fim do log: é o resto de uma escrita interrompida e é descartado.
+   Reaplicar o log sobre o snapshot do qual ele partiu é determinístico; a
+   geração diz qual é esse snapshot (o de mesma wal_generation), porque
+   reaplicar sobre um snapshot mais novo não é: SET_WEIGHT antes de ADD_EDGE
+   vira um peso que add_edge_by_index preserva. */
+#define WAL_MAGIC "RWALv1"
+#define WAL_VERSION 1u
+#define WAL_HEADER_SIZE 16
+#define WAL_GROUP_OPS 4096              // registros por commit em grupo
+#define WAL_BUF_SIZE (1 << 20)          // bytes acumulados antes de forçar o commit
+#define WAL_COMPACT_RECORDS (1 << 20)   // checkpoint quando o log passa disso
+
+enum { WAL_ADD_VERTEX = 1, WAL_ADD_EDGE, WAL_REMOVE_EDGE, WAL_REMOVE_VERTEX, WAL_SET_WEIGHT };
+
+typedef struct {
+    int fd;
+    uint8_t *buf;               // registros ainda não gravados
+    size_t len, cap;
+    int pending;                // registros em buf
+    int group_ops;              // commit a cada group_ops registros
+    uint32_t generation;        // gravada no cabeçalho; sobe a cada checkpoint
+    long long records;          // registros já no arquivo
+    long long commits;          // fdatasync feitos
+} WriteAheadLog;
+
+/* crc32 (polinômio refletido 0xEDB88320), tabela montada no primeiro uso */
+static uint32_t crc32_update(uint32_t crc, const uint8_t *p, size_t n) {
+    static uint32_t table[256];
+    static int ready = 0;
+    if (!ready) {
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; ++k) c = (c >> 1) ^ (0xEDB88320u & -(c & 1));
+            table[i] = c;
+        }
+        ready = 1;
+    }
+    crc = ~crc;
+    for (size_t i = 0; i < n; ++i) crc = table[(crc ^ p[i]) & 0xFF] ^ (crc >> 8);
+    return ~crc;
+}
+
+/* Grava todo o buffer em fd (repete em escrita parcial) */
+static int write_all(int fd, const void *data, size_t len) {
+    const char *p = data;
+    while (len > 0) {
+        ssize_t w = write(fd, p, len);
+        if (w < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        p += w;
+        len -= (size_t)w;
+    }
+    return 0;
+}
+
+/* Aplica uma mutação com a semântica do modo em lote: ADD_EDGE cria pessoas
+   desconhecidas, REMOVE_VERTEX usa a remoção rápida, operações sem efeito
+   (repetidas ou sobre pessoas inexistentes) são ignoradas.
+   Retorna 0, ou -1 só em falta de memória. */
+int wal_apply(Graph *g, int op, const char *a, size_t alen, const char *b, size_t blen) {
+    long long created = 0;
+    if (op == WAL_ADD_VERTEX) return add_vertex_len(g, a, alen) == -1 ? -1 : 0;
+    if (op == WAL_ADD_EDGE) {
+        int u = intern_vertex(g, a, alen, &created);
+        int v = intern_vertex(g, b, blen, &created);
+        if (u < 0 || v < 0) return -1;
+        add_edge_by_index(g, u, v);
+        return 0;
+    }
+    int u = find_vertex_index_len(g, a, alen);
+    if (u == -1) return 0;
+    if (op == WAL_REMOVE_VERTEX) {
+        remove_vertex_fast_by_index(g, u);
+    } else if (op == WAL_REMOVE_EDGE) {
+        int v = find_vertex_index_len(g, b, blen);
+        if (v != -1) remove_edge_by_index(g, u, v);
+    } else if (op == WAL_SET_WEIGHT && blen >= sizeof(float)) {
+        float w;
+        memcpy(&w, b + blen - sizeof(float), sizeof(float));
+        int v = find_vertex_index_len(g, b, blen - sizeof(float));
+        if (v != -1) set_edge_weight_by_index(g, u, v, w);
+    }
+    return 0;
+}
+
+/* Reaplica em g os registros íntegros de path (arquivo ausente = log vazio),
+   sendo g o snapshot da geração generation. Um log de geração anterior já
+   está todo no snapshot (checkpoint interrompido depois do rename) e é
+   ignorado. *valid_end recebe o fim do último registro íntegro (0 se o
+   arquivo não tem cabeçalho válido ou foi ignorado). Retorna registros
+   aplicados ou -1 (sem memória, erro de leitura, arquivo que não é um log
+   ou log mais novo que o snapshot). */
+long long wal_replay(const char *path, Graph *g, uint32_t generation, uint64_t *valid_end) {
+    *valid_end = 0;
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return errno == ENOENT ? 0 : -1;
+    struct stat st;
+    if (fstat(fd, &st) != 0) { close(fd); return -1; }
+    size_t size = (size_t)st.st_size;
+    if (size < WAL_HEADER_SIZE) { close(fd); return 0; } // cabeçalho interrompido: log vazio
+    void *base = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) return -1;
+    const uint8_t *p = base;
+    uint32_t version, log_generation;
+    memcpy(&version, p + 8, sizeof(version));
+    memcpy(&log_generation, p + 12, sizeof(log_generation));
+    if (memcmp(p, WAL_MAGIC, sizeof(WAL_MAGIC)) != 0 || version != WAL_VERSION ||
+        log_generation > generation) {
+        munmap(base, size);
+        return -1;
+    }
+    if (log_generation < generation) { munmap(base, size); return 0; }
+    madvise(base, size, MADV_SEQUENTIAL);
+    size_t pos = WAL_HEADER_SIZE;
+    long long applied = 0;
+    for (;;) {
+        uint32_t len, crc, alen, blen;
+        if (size - pos < 8) break;
+        memcpy(&len, p + pos, 4);
+        memcpy(&crc, p + pos + 4, 4);
+        if (len < 9 || size - pos - 8 < len) break;
+        const uint8_t *rec = p + pos + 8;
+        if (crc32_update(0, rec, len) != crc) break;
+        memcpy(&alen, rec + 1, 4);
+        if (alen > len - 9) break;
+        memcpy(&blen, rec + 5 + alen, 4);
+        if (blen != len - 9 - alen) break;
+        if (wal_apply(g, rec[0], (const char*)rec + 5, alen, (const char*)rec + 9 + alen, blen) != 0) {
+            munmap(base, size);
+            return -1;
+        }
+        applied++;
+        pos += 8 + (size_t)len;
+    }
+    munmap(base, size);
+    *valid_end = pos;
+    return applied;
+}
+
+/* Grava o cabeçalho com a geração de w no início de fd */
+static int wal_write_header(WriteAheadLog *w, int fd) {
+    uint8_t h[WAL_HEADER_SIZE] = {0};
+    uint32_t version = WAL_VERSION;
+    memcpy(h, WAL_MAGIC, sizeof(WAL_MAGIC));
+    memcpy(h + 8, &version, sizeof(version));
+    memcpy(h + 12, &w->generation, sizeof(w->generation));
+    return pwrite(fd, h, sizeof(h), 0) == (ssize_t)sizeof(h) ? 0 : -1;
+}
+
+/* Abre path para acréscimo; valid_end (de wal_replay) corta o resto de uma
+   escrita interrompida, 0 recria o arquivo só com o cabeçalho da geração
+   generation. Retorna 0 sucesso, -1 erro. */
+int wal_open(WriteAheadLog *w, const char *path, uint64_t valid_end, int group_ops, uint32_t generation) {
+    memset(w, 0, sizeof(*w));
+    w->fd = -1;
+    w->group_ops = group_ops > 0 ? group_ops : WAL_GROUP_OPS;
+    w->generation = generation;
+    w->cap = WAL_BUF_SIZE;
+    w->buf = malloc(w->cap);
+    if (!w->buf) return -1;
+    int fd = open(path, O_WRONLY | O_CREAT, 0644);
+    if (fd < 0) { free(w->buf); w->buf = NULL; return -1; }
+    int ok = 1;
+    if (valid_end < WAL_HEADER_SIZE)
+        ok = ftruncate(fd, 0) == 0 && wal_write_header(w, fd) == 0 && fdatasync(fd) == 0;
+    ok = ok && ftruncate(fd, valid_end < WAL_HEADER_SIZE ? WAL_HEADER_SIZE : (off_t)valid_end) == 0 &&
+         lseek(fd, 0, SEEK_END) >= 0;
+    if (!ok) { close(fd); free(w->buf); w->buf = NULL; return -1; }
+    w->fd = fd;
+    return 0;
+}
+
+/* Grava os registros acumulados e espera o disco (um fdatasync por grupo) */
+int wal_commit(WriteAheadLog *w) {
+    if (w->pending == 0) return 0;
+    if (write_all(w->fd, w->buf, w->len) != 0 || fdatasync(w->fd) != 0) return -1;
+    w->records += w->pending;
+    w->commits++;
+    w->pending = 0;
+    w->len = 0;
+    return 0;
+}
+
+/* Acrescenta um registro ao grupo atual; fecha o grupo quando enche.
+   A mutação só é durável depois do commit do grupo. Retorna 0 ou -1. */
+int wal_append(WriteAheadLog *w, int op, const char *a, size_t alen, const char *b, size_t blen) {
+    if (alen > UINT32_MAX - 64 || blen > UINT32_MAX - 64 - alen) return -1;
+    size_t need = 8 + 9 + alen + blen;
+    if (w->len + need > w->cap) {
+        if (wal_commit(w) != 0) return -1;
+        if (need > w->cap) { // registro maior que o buffer inteiro
+            uint8_t *nb = realloc(w->buf, need);
+            if (!nb) return -1;
+            w->buf = nb;
+            w->cap = need;
+        }
+    }
+    uint8_t *r = w->buf + w->len;
+    uint32_t len = (uint32_t)(need - 8), la = (uint32_t)alen, lb = (uint32_t)blen;
+    memcpy(r, &len, 4);
+    r[8] = (uint8_t)op;
+    memcpy(r + 9, &la, 4);
+    if (alen) memcpy(r + 13, a, alen);
+    memcpy(r + 13 + alen, &lb, 4);
+    if (blen) memcpy(r + 17 + alen, b, blen);
+    uint32_t crc = crc32_update(0, r + 8, len);
+    memcpy(r + 4, &crc, 4);
+    w->len += need;
+    if (++w->pending >= w->group_ops) return wal_commit(w);
+    return 0;
+}
+
+/* Registro SET_WEIGHT: o peso vai no fim do campo b */
+int wal_append_weight(WriteAheadLog *w, const char *a, size_t alen, const char *b, size_t blen, float weight) {
+    char *nb = malloc(blen + sizeof(float));
+    if (!nb) return -1;
+    if (blen) memcpy(nb, b, blen);
+    memcpy(nb + blen, &weight, sizeof(float));
+    int r = wal_append(w, WAL_SET_WEIGHT, a, alen, nb, blen + sizeof(float));
+    free(nb);
+    return r;
+}
+
+/* Esvazia o log e passa para a geração seguinte (depois de um checkpoint).
+   O corte vai para o disco antes do cabeçalho novo: um crash entre os dois
+   deixa a geração antiga, que a recuperação ignora, nunca registros antigos
+   sob a geração nova. */
+static int wal_reset(WriteAheadLog *w) {
+    w->len = 0;
+    w->pending = 0;
+    w->records = 0;
+    if (ftruncate(w->fd, WAL_HEADER_SIZE) != 0 || fdatasync(w->fd) != 0) return -1;
+    w->generation++;
+    if (wal_write_header(w, w->fd) != 0 || lseek(w->fd, 0, SEEK_END) < 0) return -1;
+    return fdatasync(w->fd) == 0 ? 0 : -1;
+}
+
+/* Fecha com commit do grupo pendente (retorna 0 ou -1) */
+int wal_close(WriteAheadLog *w) {
+    int r = w->fd >= 0 ? wal_commit(w) : 0;
+    if (w->fd >= 0 && close(w->fd) != 0) r = -1;
+    w->fd = -1;
+    free(w->buf);
+    w->buf = NULL;
+    return r;
+}
+
+/* Grafo durável: snapshot binário + log das mutações feitas depois dele */
+typedef struct {
+    Graph g;
+    WriteAheadLog wal;
+    const char *snapshot_path;  // strings do chamador (devem viver até durable_close)
+    const char *wal_path;
+    long long compact_records;  // checkpoint automático acima disso
+} DurableGraph;
+
+/* Força o conteúdo de path para o disco */
+static int fsync_path(const char *path) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return -1;
+    int r = fsync(fd);
+    if (close(fd) != 0) r = -1;
+    return r;
+}
+
+/* Força para o disco a entrada de path no seu diretório (depois de um rename) */
+static int fsync_parent_dir(const char *path) {
+    const char *slash = strrchr(path, '/');
+    size_t len = slash ? (size_t)(slash - path) : 1;
+    if (slash && len == 0) len = 1; // arquivo na raiz
+    char *dir = malloc(len + 1);
+    if (!dir) return -1;
+    if (slash) memcpy(dir, path, len);
+    else dir[0] = '.';
+    dir[len] = '\0';
+    int fd = open(dir, O_RDONLY | O_DIRECTORY);
+    free(dir);
+    if (fd < 0) return -1;
+    int r = fsync(fd);
+    if (close(fd) != 0) r = -1;
+    return r;
+}
+
+/* Recupera o estado: mapeia o snapshot (se existir), reaplica a cauda do
+   log e o reabre para acréscimo. *replayed recebe os registros reaplicados.
+   Retorna 0 sucesso, -1 erro (snapshot ou log inválidos, sem memória). */
+int durable_open(DurableGraph *d, const char *snapshot_path, const char *wal_path,
+                 int group_ops, long long *replayed) {
+    init_graph(&d->g);
+    d->snapshot_path = snapshot_path;
+    d->wal_path = wal_path;
+    d->compact_records = WAL_COMPACT_RECORDS;
+    d->wal.fd = -1;
+    d->wal.buf = NULL;
+    *replayed = 0;
+    uint32_t generation = 0;
+    if (access(snapshot_path, F_OK) == 0) {
+        GraphSnapshot snap;
+        if (load_snapshot(snapshot_path, &snap) != 0) return -1;
+        int r = graph_from_snapshot(&d->g, &snap);
+        generation = snap.wal_generation;
+        snapshot_close(&snap);
+        if (r != 0) { free_graph(&d->g); return -1; }
+    }
+    uint64_t valid_end;
+    long long n = wal_replay(wal_path, &d->g, generation, &valid_end);
+    if (n < 0 || wal_open(&d->wal, wal_path, valid_end, group_ops, generation) != 0) {
+        free_graph(&d->g);
+        return -1;
+    }
+    *replayed = n;
+    return 0;
+}
+
+/* Registra e aplica uma mutação (semântica de wal_apply) */
+int durable_apply(DurableGraph *d, int op, const char *a, size_t alen, const char *b, size_t blen) {
+    if (wal_append(&d->wal, op, a, alen, b, blen) != 0) return -1;
+    return wal_apply(&d->g, op, a, alen, b, blen);
+}
+
+/* Compactação: grava o snapshot ao lado com a geração seguinte do log,
+   troca por rename (atômico), força o diretório para o disco e só então
+   esvazia o log, que passa a essa geração. Se cair no meio, sobra o
+   snapshot antigo + log completo, ou o novo + log da geração anterior, já
+   contido nele e ignorado na recuperação (reaplicá-lo não seria inofensivo:
+   ver wal_replay). Sem o fsync do diretório o rename poderia se perder num
+   crash depois do log já vazio. Retorna 0 ou -1 (log intacto). */
+int durable_checkpoint(DurableGraph *d) {
+    if (wal_commit(&d->wal) != 0) return -1;
+    size_t len = strlen(d->snapshot_path);
+    char *tmp = malloc(len + 5);
+    if (!tmp) return -1;
+    memcpy(tmp, d->snapshot_path, len);
+    memcpy(tmp + len, ".tmp", 5);
+    int r = save_snapshot_generation(&d->g, tmp, d->wal.generation + 1);
+    if (r == 0) r = fsync_path(tmp);
+    if (r == 0) r = rename(tmp, d->snapshot_path);
+    if (r == 0) r = fsync_parent_dir(d->snapshot_path);
+    if (r != 0) unlink(tmp);
+    free(tmp);
+    if (r == 0) r = wal_reset(&d->wal);
+    return r;
+}
+
+/* Checkpoint quando o log cresceu além de compact_records */
+int durable_maybe_compact(DurableGraph *d) {
+    if (d->wal.records + d->wal.pending < d->compact_records) return 0;
+    return durable_checkpoint(d);
+}
+
+/* Commit final e liberação (retorna 0, ou -1 se o último grupo falhou) */
+int durable_close(DurableGraph *d) {
+    int r = wal_close(&d->wal);
+    free_graph(&d->g);
+    return r;
+}
+
+/* ----- Modo de comandos em lote ----- */
+
+/* Protocolo: um comando por linha, campos separados por espaço ou TAB;
+   linhas vazias e comentários (#) são ignorados.
+     ADD_VERTEX a | ADD_EDGE a b | REMOVE_EDGE a b | REMOVE_VERTEX a
+     HAS_EDGE a b | CONNECTED a b | BFS a | DFS a | KHOP a k | PATH a b
+     RECOMMEND a k | DEGREE a | TOP k | COUNT | CHECKPOINT
+     WEIGHT a b peso | WPATH a b
+   Mutações não respondem (erros saem como "ERR linha mensagem"); consultas
+   respondem uma linha cada, na ordem dos comandos. ADD_EDGE cria pessoas
+   desconhecidas (como a importação) e é acumulado e inserido em lote até
+   o próximo comando de outro tipo. REMOVE_VERTEX usa a remoção rápida.
+   WEIGHT define o peso (>= 0) de uma amizade existente; WPATH responde
+   "custo total: nomes" do menor caminho ponderado, ou -1.
+   Com --durable as mutações vão para o log (WAL) antes de serem aplicadas;
+   CHECKPOINT grava o snapshot e esvazia o log. */
+
+#define BATCH_MAX_ARGS 3
+
+typedef struct {
+    const char *p;
+    size_t len;
+} Token;
+
+typedef struct {
+    Graph *g;
+    DurableGraph *dg;           // NULL = sem log
+    OutBuf *out;
+    int *pairs;                 // ADD_EDGE pendentes
+    size_t npairs;
+    TraversalCtx ctx;
+    RecommendCtx rec;
+    PathCtx path;
+    int *scratch;               // saída dos percursos
+    Recommendation *recs;
+    int scratch_cap, recs_cap;
+    long long line, commands, errors;
+    ImportStats st;             // só contagem de pessoas criadas
+} BatchState;
+
+static int batch_flush_edges(BatchState *b) {
+    if (b->npairs == 0) return 0;
+    long long added = add_edges_batch(b->g, b->pairs, b->npairs);
+    b->npairs = 0;
+    return added < 0 ? -1 : 0;
+}
+
+static void batch_error(BatchState *b, const char *msg) {
+    b->errors++;
+    outbuf_puts(b->out, "ERR ");
+    outbuf_int(b->out, (int)b->line);
+    outbuf_putc(b->out, ' ');
+    outbuf_puts(b->out, msg);
+    outbuf_putc(b->out, '\n');
+}
+
+static void batch_name(BatchState *b, int v) {
+    outbuf_write(b->out, vertex_name(b->g, v), b->g->vertices[v].name_len);
+}
+
+/* Grava "total: nome nome ..." */
+static void batch_vertex_list(BatchState *b, const int *v, int count) {
+    outbuf_int(b->out, count);
+    outbuf_putc(b->out, ':');
+    for (int i = 0; i < count; ++i) {
+        outbuf_putc(b->out, ' ');
+        batch_name(b, v[i]);
+    }
+    outbuf_putc(b->out, '\n');
+}
+
+/* Índice da pessoa do token; -1 (com erro registrado) se não existe */
+static int batch_vertex(BatchState *b, const Token *t) {
+    int v = find_vertex_index_len(b->g, t->p, t->len);
+    if (v == -1) batch_error(b, "pessoa nao encontrada");
+    return v;
+}
+
+static int batch_reserve(BatchState *b) {
+    int n = b->g->n > 0 ? b->g->n : 1;
+    if (n <= b->scratch_cap) return 0;
+    int *ns = realloc(b->scratch, sizeof(int) * (size_t)n);
+    if (!ns) return -1;
+    b->scratch = ns;
+    b->scratch_cap = n;
+    return 0;
+}
+
+static int tok_eq(const Token *t, const char *s) {
+    return strlen(s) == t->len && memcmp(t->p, s, t->len) == 0;
+}
+
+/* Inteiro positivo do token (os tokens não terminam em \0); -1 se inválido */
+static int tok_int(const Token *t) {
+    if (t->len == 0 || t->len > 9) return -1;
+    int x = 0;
+    for (size_t i = 0; i < t->len; ++i) {
+        if (t->p[i] < '0' || t->p[i] > '9') return -1;
+        x = x * 10 + (t->p[i] - '0');
+    }
+    return x;
+}
+
+/* Peso do token (número finito >= 0); -1 se inválido */
+static double tok_weight(const Token *t) {
+    char buf[32];
+    if (t->len == 0 || t->len >= sizeof(buf)) return -1.0;
+    memcpy(buf, t->p, t->len);
+    buf[t->len] = '\0';
+    char *end;
+    double w = strtod(buf, &end);
+    if (*end != '\0' || !(w >= 0.0) || w > FLT_MAX) return -1.0;
+    return w;
+}
+
+/* Registra a mutação no log antes de aplicá-la (sem log, nada a fazer) */
+static int batch_log(BatchState *b, int op, const Token *a, int nargs) {
+    if (!b->dg) return 0;
+    return wal_append(&b->dg->wal, op, a[0].p, a[0].len, nargs > 1 ? a[1].p : NULL, nargs > 1 ? a[1].len : 0);
+}
+
+/* Executa um comando já tokenizado; -1 só em falta de memória ou erro do log */
+static int batch_exec(BatchState *b, const Token *cmd, const Token *a, int nargs) {
+    Graph *g = b->g;
+    if (tok_eq(cmd, "ADD_EDGE") && nargs == 2) {
+        if (batch_log(b, WAL_ADD_EDGE, a, nargs) != 0) return -1;
+        int u = intern_vertex(g, a[0].p, a[0].len, &b->st.vertices_added);
+        int v = intern_vertex(g, a[1].p, a[1].len, &b->st.vertices_added);
+        if (u < 0 || v < 0) return -1;
+        b->pairs[2 * b->npairs] = u;
+        b->pairs[2 * b->npairs + 1] = v;
+        if (++b->npairs == IMPORT_BATCH_PAIRS) return batch_flush_edges(b);
+        return 0;
+    }
+    // qualquer outro comando enxerga as arestas pendentes
+    if (batch_flush_edges(b) != 0) return -1;
+    // ponto seguro para compactar: nada pendente fora do grafo
+    if (b->dg && durable_maybe_compact(b->dg) != 0) return -1;
+    if (tok_eq(cmd, "CHECKPOINT") && nargs == 0) {
+        if (!b->dg) batch_error(b, "sem log (use --durable)");
+        else if (durable_checkpoint(b->dg) != 0) return -1;
+        return 0;
+    }
+    int op = tok_eq(cmd, "ADD_VERTEX") ? WAL_ADD_VERTEX : tok_eq(cmd, "REMOVE_EDGE") ? WAL_REMOVE_EDGE
+           : tok_eq(cmd, "REMOVE_VERTEX") ? WAL_REMOVE_VERTEX : 0;
+    if (op && nargs == (op == WAL_REMOVE_EDGE ? 2 : 1) && batch_log(b, op, a, nargs) != 0) return -1;
+    if (tok_eq(cmd, "ADD_VERTEX") && nargs == 1) {
+        int r = add_vertex_len(g, a[0].p, a[0].len);
+        if (r == -1) return -1;
+        if (r == -2) batch_error(b, "pessoa ja existe");
+    } else if (tok_eq(cmd, "REMOVE_EDGE") && nargs == 2) {
+        int u = batch_vertex(b, &a[0]), v = u < 0 ? -1 : batch_vertex(b, &a[1]);
+        if (v >= 0 && remove_edge_by_index(g, u, v) != 0) batch_error(b, "amizade nao existe");
+    } else if (tok_eq(cmd, "REMOVE_VERTEX") && nargs == 1) {
+        int u = batch_vertex(b, &a[0]);
+        if (u >= 0) remove_vertex_fast_by_index(g, u);
+    } else if (tok_eq(cmd, "WEIGHT") && nargs == 3) {
+        double w = tok_weight(&a[2]);
+        if (w < 0) { batch_error(b, "peso invalido"); return 0; }
+        if (b->dg && wal_append_weight(&b->dg->wal, a[0].p, a[0].len, a[1].p, a[1].len, (float)w) != 0) return -1;
+        int u = batch_vertex(b, &a[0]), v = u < 0 ? -1 : batch_vertex(b, &a[1]);
+        if (v >= 0 && set_edge_weight_by_index(g, u, v, (float)w) != 0) batch_error(b, "amizade nao existe");
+    } else if ((tok_eq(cmd, "HAS_EDGE") || tok_eq(cmd, "CONNECTED")) && nargs == 2) {
+        int u = batch_vertex(b, &a[0]), v = u < 0 ? -1 : batch_vertex(b, &a[1]);
+        if (v < 0) return 0;
+        int r = cmd->p[0] == 'H' ? has_edge_by_index(g, u, v) : connected_by_index(g, u, v);
+        if (r < 0) return -1;
+        outbuf_putc(b->out, r ? '1' : '0');
+        outbuf_putc(b->out, '\n');
+    } else if ((tok_eq(cmd, "BFS") || tok_eq(cmd, "DFS")) && nargs == 1) {
+        int u = batch_vertex(b, &a[0]);
+        if (u < 0) return 0;
+        if (batch_reserve(b) != 0) return -1;
+        int count = cmd->p[0] == 'B' ? bfs_ctx(g, &b->ctx, u, b->scratch, g->n)
+                                     : dfs_ctx(g, &b->ctx, u, b->scratch, g->n);
+        batch_vertex_list(b, b->scratch, count);
+    } else if (tok_eq(cmd, "KHOP") && nargs == 2) {
+        int u = batch_vertex(b, &a[0]);
+        if (u < 0) return 0;
+        int k = tok_int(&a[1]);
+        if (k < 1) { batch_error(b, "k invalido"); return 0; }
+        if (batch_reserve(b) != 0) return -1;
+        batch_vertex_list(b, b->scratch, khop_ctx(g, &b->ctx, u, k, k, b->scratch, g->n));
+    } else if (tok_eq(cmd, "PATH") && nargs == 2) {
+        int u = batch_vertex(b, &a[0]), v = u < 0 ? -1 : batch_vertex(b, &a[1]);
+        if (v < 0) return 0;
+        if (batch_reserve(b) != 0) return -1;
+        int len = shortest_path_ctx(g, &b->ctx, u, v, b->scratch, g->n);
+        if (len < 0) outbuf_puts(b->out, "-1\n");
+        else batch_vertex_list(b, b->scratch, len);
+    } else if (tok_eq(cmd, "WPATH") && nargs == 2) {
+        int u = batch_vertex(b, &a[0]), v = u < 0 ? -1 : batch_vertex(b, &a[1]);
+        if (v < 0) return 0;
+        if (batch_reserve(b) != 0) return -1;
+        double cost;
+        int len = weighted_path_ctx(g, &b->path, u, v, b->scratch, g->n, &cost);
+        if (len < 0) { outbuf_puts(b->out, "-1\n"); return 0; }
+        char num[32];
+        snprintf(num, sizeof(num), "%g ", cost);
+        outbuf_puts(b->out, num);
+        batch_vertex_list(b, b->scratch, len);
+    } else if (tok_eq(cmd, "RECOMMEND") && nargs == 2) {
+        int u = batch_vertex(b, &a[0]);
+        if (u < 0) return 0;
+        int k = tok_int(&a[1]);
+        if (k < 1) { batch_error(b, "k invalido"); return 0; }
+        if (k > b->recs_cap) {
+            Recommendation *nr = realloc(b->recs, sizeof(Recommendation) * (size_t)k);
+            if (!nr) return -1;
+            b->recs = nr;
+            b->recs_cap = k;
+        }
+        int count = recommend_friends_ctx(g, &b->rec, u, k, RECOMMEND_MUTUAL, b->recs);
+        if (count < 0) return -1;
+        outbuf_int(b->out, count);
+        outbuf_putc(b->out, ':');
+        for (int i = 0; i < count; ++i) {
+            outbuf_putc(b->out, ' ');
+            batch_name(b, b->recs[i].v);
+            outbuf_putc(b->out, '=');
+            outbuf_int(b->out, b->recs[i].mutual);
+        }
+        outbuf_putc(b->out, '\n');
+    } else if (tok_eq(cmd, "DEGREE") && nargs == 1) {
+        int u = batch_vertex(b, &a[0]);
+        if (u < 0) return 0;
+        outbuf_int(b->out, vertex_degree(g, u));
+        outbuf_putc(b->out, '\n');
+    } else if (tok_eq(cmd, "TOP") && nargs == 1) {
+        int k = tok_int(&a[0]);
+        if (k < 1) { batch_error(b, "k invalido"); return 0; }
+        if (batch_reserve(b) != 0) return -1;
+        int count = top_degree(g, k, b->scratch);
+        outbuf_int(b->out, count);
+        outbuf_putc(b->out, ':');
+        for (int i = 0; i < count; ++i) {
+            outbuf_putc(b->out, ' ');
+            batch_name(b, b->scratch[i]);
+            outbuf_putc(b->out, '=');
+            outbuf_int(b->out, g->vertices[b->scratch[i]].degree);
+        }
+        outbuf_putc(b->out, '\n');
+    } else if (tok_eq(cmd, "COUNT") && nargs == 0) {
+        long long m2 = 0;
+        for (int i = 0; i < g->n; ++i) m2 += g->vertices[i].degree;
+        char line[48];
+        snprintf(line, sizeof(line), "%d %lld\n", g->n, m2 / 2);
+        outbuf_puts(b->out, line);
+    } else {
+        batch_error(b, "comando invalido");
+    }
+    return 0;
+}
+
+static int is_blank(char c) { return c == ' ' || c == '\t'; }
+
+static int batch_line(void *arg, const char *p, const char *end) {
+    BatchState *b = arg;
+    b->line++;
+    Token t[BATCH_MAX_ARGS + 2];
+    int nt = 0;
+    while (nt < BATCH_MAX_ARGS + 2) {
+        while (p < end && is_blank(*p)) p++;
+        if (p == end) break;
+        t[nt].p = p;
+        while (p < end && !is_blank(*p)) p++;
+        t[nt].len = (size_t)(p - t[nt].p);
+        nt++;
+    }
+    if (nt == 0 || t[0].p[0] == '#') return 0;
+    b->commands++;
+    if (nt > BATCH_MAX_ARGS + 1) { batch_error(b, "argumentos demais"); return 0; }
+    return batch_exec(b, &t[0], &t[1], nt - 1);
+}
+
+/* Executa os comandos de in sobre g, respondendo em out (buffer grande, sem
+   prompts). Retorna 0 sucesso (erros de comando são respondidos e contados
+   em *errors), -1 em falta de memória ou erro de leitura/escrita. */
+static int batch_run(Graph *g, DurableGraph *dg, FILE *in, FILE *out, long long *commands, long long *errors) {
+    BatchState b;
+    memset(&b, 0, sizeof(b));
+    b.g = g;
+    b.dg = dg;
+    OutBuf o;
+    if (outbuf_open(&o, out) != 0) return -1;
+    b.out = &o;
+    traversal_ctx_init(&b.ctx);
+    recommend_ctx_init(&b.rec);
+    path_ctx_init(&b.path);
+    b.pairs = malloc(sizeof(int) * 2 * IMPORT_BATCH_PAIRS);
+    int r = b.pairs ? read_lines(in, batch_line, &b) : -1;
+    if (r == 0) r = batch_flush_edges(&b);
+    if (r == 0 && dg) r = wal_commit(&dg->wal);
+    if (outbuf_close(&o) != 0) r = -1;
+    traversal_ctx_free(&b.ctx);
+    recommend_ctx_free(&b.rec);
+    path_ctx_free(&b.path);
+    free(b.pairs);
+    free(b.scratch);
+    free(b.recs);
+    *commands = b.commands;
+    *errors = b.errors;
+    return r;
+}
+
+int run_batch_commands(Graph *g, FILE *in, FILE *out, long long *commands, long long *errors) {
+    return batch_run(g, NULL, in, out, commands, errors);
+}
+
+/* Igual a run_batch_commands, registrando as mutações no log de d
+   (commit em grupo; o último grupo é gravado no fim da entrada) */
+int run_durable_commands(DurableGraph *d, FILE *in, FILE *out, long long *commands, long long *errors) {
+    return batch_run(&d->g, d, in, out, commands, errors);
+}
+
+/* ----- Geradores de grafos sintéticos ----- */
+
+/* splitmix64: gerador pequeno e reprodutível a partir da semente */
+static inline uint64_t rng_next(uint64_t *state) {
+    uint64_t z = (*state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+/* Inteiro uniforme em [0, n) */
+static inline int rng_below(uint64_t *state, int n) {
+    return (int)(((rng_next(state) >> 32) * (uint64_t)n) >> 32);
+}
+
+/* Gera pares (u,v) sobre n vértices: "er" (m pares uniformes), "rmat"
+   (quadrantes 0.57/0.19/0.19/0.05, como no Graph500) ou "ba" (ligação
+   preferencial, m/n arestas por vértice novo). Podem sair laços e
+   repetições; a inserção os descarta. Retorna vetor alocado com 2*(*out_m)
+   inteiros ou NULL (modelo desconhecido ou sem memória). */
+int *generate_edges(const char *model, int n, long long m, uint64_t seed, size_t *out_m) {
+    *out_m = 0;
+    if (n < 2 || m < 0) return NULL;
+    int *pairs = malloc(sizeof(int) * 2 * (size_t)(m > 0 ? m : 1));
+    if (!pairs) return NULL;
+    uint64_t st = seed;
+    size_t k = 0;
+    if (strcmp(model, "er") == 0) {
+        for (long long i = 0; i < m; ++i) {
+            pairs[2 * k] = rng_below(&st, n);
+            pairs[2 * k + 1] = rng_below(&st, n);
+            k++;
+        }
+    } else if (strcmp(model, "rmat") == 0) {
+        int scale = 0;
+        while ((1LL << scale) < n) scale++;
+        while ((long long)k < m) {
+            int u = 0, v = 0;
+            for (int b = 0; b < scale; ++b) {
+                uint32_t r = (uint32_t)(rng_next(&st) >> 32);
+                // a = 0.57, b = 0.19, c = 0.19, d = 0.05 (limiares em 2^32)
+                int bu = r >= 3264175145u, bv = (r >= 2448131359u && r < 3264175145u) || r >= 4080218931u;
+                u = (u << 1) | bu;
+                v = (v << 1) | bv;
+            }
+            if (u >= n || v >= n) continue; // fora do intervalo quando n não é potência de 2
+            pairs[2 * k] = u;
+            pairs[2 * k + 1] = v;
+            k++;
+        }
+    } else if (strcmp(model, "ba") == 0) {
+        // cada vértice novo u liga-se a d alvos; sortear uma ponta dos pares
+        // já gerados escolhe o alvo com probabilidade proporcional ao grau
+        int d = (int)(m / n > 0 ? m / n : 1);
+        for (int u = d; u < n && (long long)k < m; ++u)
+            for (int j = 0; j < d && (long long)k < m; ++j) {
+                int v = k < (size_t)d ? j : pairs[rng_next(&st) % (2 * (uint64_t)k)];
+                pairs[2 * k] = u;
+                pairs[2 * k + 1] = v;
+                k++;
+            }
+    } else {
+        free(pairs);
+        return NULL;
+    }
+    *out_m = k;
+    return pairs;
+}
+
+/* ----- Benchmark ----- */
+
+/* Medição de uma operação: total + amostra de latências para percentis */
+typedef struct {
+    const char *name;
+    long long ops;
+    double seconds;
+    double *lat;            // latências amostradas (segundos)
+    int nlat;
+    long long stride;       // mede 1 a cada stride operações
+} BenchStat;
+
+static void bench_init(BenchStat *b, const char *name, long long expected_ops) {
+    b->name = name;
+    b->ops = 0;
+    b->seconds = 0.0;
+    b->nlat = 0;
+    b->stride = expected_ops / BENCH_SAMPLES + 1;
+    b->lat = malloc(sizeof(double) * BENCH_SAMPLES);
+}
+
+/* Registra uma operação medida de t0 a t1 */
+static inline void bench_add(BenchStat *b, double t0, double t1) {
+    if (b->lat && b->ops % b->stride == 0 && b->nlat < BENCH_SAMPLES) b->lat[b->nlat++] = t1 - t0;
+    b->seconds += t1 - t0;
+    b->ops++;
+}
+
+static int cmp_double(const void *a, const void *b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+static double bench_percentile(const BenchStat *b, double p) {
+    if (b->nlat == 0) return 0.0;
+    int i = (int)(p * (b->nlat - 1) + 0.5);
+    return b->lat[i];
+}
+
+/* Imprime vazão e percentis (microssegundos) e libera a amostra */
+static void bench_report(BenchStat *b) {
+    if (b->lat) qsort(b->lat, (size_t)b->nlat, sizeof(double), cmp_double);
+    printf("%-26s %10lld %9.3f s %12.0f op/s", b->name, b->ops, b->seconds,
+           b->seconds > 0 ? (double)b->ops / b->seconds : 0.0);
+    // percentis só fazem sentido com várias operações medidas separadamente
+    if (b->nlat > 1)
+        printf(" | p50 %9.2f p90 %9.2f p99 %9.2f max %10.2f us",
+               bench_percentile(b, 0.50) * 1e6, bench_percentile(b, 0.90) * 1e6,
+               bench_percentile(b, 0.99) * 1e6, bench_percentile(b, 1.0) * 1e6);
+    printf("\n");
+    free(b->lat);
+    b->lat = NULL;
+}
+
+/* Pico de memória residente do processo em MiB */
+double peak_rss_mib(void) {
+    struct rusage ru;
+    if (getrusage(RUSAGE_SELF, &ru) != 0) return 0.0;
+    return (double)ru.ru_maxrss / 1024.0; // ru_maxrss em KiB no Linux
+}
 
-/* Exibe lista de adjacência */
-void display_adj_list(Graph *g) {
-    printf("Lista de Adjacência:\n");
-    for (int i = 0; i < g->n; ++i) {
-        printf(" %d: %s -> ", i, g->vertices[i].name);
-        AdjNode *curr = g->vertices[i].head;
-        if (!curr) printf("NULL");
-        while (curr) {
-            printf("%s", g->vertices[curr->v].name);
-            if (curr->next) printf(" -> ");
-            curr = curr->next;
+/* Confere csr_bfs_parallel contra csr_bfs_do (alcançados e nível de cada
+   vértice) com várias quantidades de threads. Retorna consultas divergentes,
+   ou -1 sem memória. */
+static int verify_parallel_bfs(CSRGraph *c, const int *sources, int nsources, int *order) {
+    static const int threads[] = { 1, 2, 3, 4, 8, 0 }; // 0 = padrão da máquina
+    int *ref = malloc(sizeof(int) * ((size_t)c->n + 1));
+    int *level = malloc(sizeof(int) * ((size_t)c->n + 1));
+    if (!ref || !level) { free(ref); free(level); return -1; }
+    int bad = 0;
+    for (int i = 0; i < nsources; ++i) {
+        int expected = csr_bfs_do(c, sources[i], order, c->n, ref);
+        for (size_t t = 0; t < sizeof(threads) / sizeof(threads[0]); ++t) {
+            int got = csr_bfs_parallel(c, sources[i], order, c->n, level, threads[t]);
+            if (got != expected || memcmp(ref, level, sizeof(int) * (size_t)c->n) != 0) {
+                printf("Divergência: origem %d, %d thread(s): %d alcançados, esperado %d\n",
+                       sources[i], threads[t] ? threads[t] : default_thread_count(), got, expected);
+                bad++;
+                break;
+            }
         }
-        printf("\n");
     }
+    free(ref);
+    free(level);
+    return bad;
 }
 
-/* Exibe matriz de adjacência */
-void display_adj_matrix(Graph *g) {
-    printf("\nMatriz de Adjacência (0/1):\n    ");
-    for (int j = 0; j < g->n; ++j) {
-        printf("%3d", j);
+/* Roda o benchmark completo com um grafo sintético de n vértices e m pares.
+   Retorna 0 sucesso, -1 erro. */
+int run_benchmark(const char *model, int n, long long m, uint64_t seed) {
+    size_t np;
+    double t0 = now_seconds();
+    int *pairs = generate_edges(model, n, m, seed, &np);
+    if (!pairs) return -1;
+    printf("Modelo %s: %d vértices, %zu pares gerados em %.3f s (semente %llu)\n",
+           model, n, np, now_seconds() - t0, (unsigned long long)seed);
+    uint64_t st = seed ^ 0x5DEECE66DULL;
+    BenchStat b;
+    char name[32];
+
+    // 1) ingestão: vértices, arestas uma a uma e em lote
+    Graph g;
+    init_graph(&g);
+    bench_init(&b, "add_vertex", n);
+    for (int i = 0; i < n; ++i) {
+        snprintf(name, sizeof(name), "p%d", i);
+        double a = now_seconds();
+        if (add_vertex(&g, name) != 0) { free(pairs); free_graph(&g); free(b.lat); return -1; }
+        bench_add(&b, a, now_seconds());
     }
-    printf("\n   +");
-    for (int j = 0; j < g->n; ++j) printf("---");
-    printf("\n");
-    for (int i = 0; i < g->n; ++i) {
-        printf("%2d |", i);
-        for (int j = 0; j < g->n; ++j) {
-            printf("%3d", g->adjMatrix[i][j]);
+    bench_report(&b);
+    long long added = 0;
+    bench_init(&b, "add_edge_by_index", (long long)np);
+    for (size_t i = 0; i < np; ++i) {
+        double a = now_seconds();
+        added += add_edge_by_index(&g, pairs[2 * i], pairs[2 * i + 1]) == 0;
+        bench_add(&b, a, now_seconds());
+    }
+    bench_report(&b);
+    {
+        Graph h;
+        init_graph(&h);
+        graph_reserve(&h, n);
+        for (int i = 0; i < n; ++i) {
+            snprintf(name, sizeof(name), "p%d", i);
+            add_vertex(&h, name);
         }
-        printf("   %s\n", g->vertices[i].name);
+        bench_init(&b, "add_edges_batch (pares)", 1);
+        double a = now_seconds();
+        add_edges_batch(&h, pairs, np);
+        bench_add(&b, a, now_seconds());
+        b.ops = (long long)np;
+        bench_report(&b);
+        free_graph(&h);
     }
-}
+    free(pairs);
+    printf("Arestas distintas: %lld\n", added);
 
-/* Gera e exibe matriz de incidência (n x m) */
-void display_incidence_matrix(Graph *g) {
-    // Primeiro, coletar todas as arestas (u < v)
-    int m = 0;
-    int edges[MAX_VERTICES * MAX_VERTICES][2]; // lista de pares (u,v)
-    for (int u = 0; u < g->n; ++u) {
-        for (int v = u + 1; v < g->n; ++v) {
-            if (g->adjMatrix[u][v]) {
-                edges[m][0] = u;
-                edges[m][1] = v;
-                m++;
-            }
-        }
+    // 2) consultas pontuais
+    bench_init(&b, "find_vertex_index", 1000000);
+    for (int i = 0; i < 1000000; ++i) {
+        snprintf(name, sizeof(name), "p%d", rng_below(&st, n));
+        double a = now_seconds();
+        if (find_vertex_index(&g, name) < 0) printf("Erro: nome ausente.\n");
+        bench_add(&b, a, now_seconds());
     }
-    printf("\nMatriz de Incidência (%d vértices x %d arestas):\n    ", g->n, m);
-    for (int e = 0; e < m; ++e) printf("%3d", e);
-    printf("\n   +");
-    for (int e = 0; e < m; ++e) printf("---");
-    printf("\n");
-    for (int i = 0; i < g->n; ++i) {
-        printf("%2d |", i);
-        for (int e = 0; e < m; ++e) {
-            int a = edges[e][0], b = edges[e][1];
-            if (i == a || i == b) printf("%3d", 1);
-            else printf("%3d", 0);
-        }
-        printf("   %s\n", g->vertices[i].name);
+    bench_report(&b);
+    bench_init(&b, "has_edge_by_index", 1000000);
+    for (int i = 0; i < 1000000; ++i) {
+        int u = rng_below(&st, n), v = rng_below(&st, n);
+        double a = now_seconds();
+        has_edge_by_index(&g, u, v);
+        bench_add(&b, a, now_seconds());
     }
-    if (m == 0) printf("(Sem arestas)\n");
-}
+    bench_report(&b);
 
-/* Visualização ASCII simples */
-void ascii_visual(Graph *g) {
-    printf("\nVisualização ASCII (lista):\n");
-    for (int i = 0; i < g->n; ++i) {
-        printf("[%d] %s", i, g->vertices[i].name);
-        AdjNode *curr = g->vertices[i].head;
-        if (!curr) { printf(" -- (sem amigos)\n"); continue; }
-        printf(" -- ");
-        int first = 1;
-        while (curr) {
-            if (!first) printf(", ");
-            printf("%s", g->vertices[curr->v].name);
-            first = 0;
-            curr = curr->next;
+    // 3) percursos (latência por consulta completa)
+    int *order = malloc(sizeof(int) * (size_t)n);
+    int *sources = malloc(sizeof(int) * BENCH_QUERIES);
+    CSRGraph c;
+    if (!order || !sources || freeze_graph(&g, &c, 1) != 0) {
+        free(order); free(sources); free_graph(&g);
+        return -1;
+    }
+    for (int i = 0; i < BENCH_QUERIES; ++i) sources[i] = rng_below(&st, n);
+    TraversalCtx ctx;
+    traversal_ctx_init(&ctx);
+    long long reached = 0;
+    bench_init(&b, "bfs_ctx (listas)", BENCH_QUERIES);
+    for (int i = 0; i < BENCH_QUERIES; ++i) {
+        double a = now_seconds();
+        reached += bfs_ctx(&g, &ctx, sources[i], order, n);
+        bench_add(&b, a, now_seconds());
+    }
+    bench_report(&b);
+    bench_init(&b, "dfs_ctx (listas)", BENCH_QUERIES);
+    for (int i = 0; i < BENCH_QUERIES; ++i) {
+        double a = now_seconds();
+        dfs_ctx(&g, &ctx, sources[i], order, n);
+        bench_add(&b, a, now_seconds());
+    }
+    bench_report(&b);
+    bench_init(&b, "csr_bfs_do (direção)", BENCH_QUERIES);
+    for (int i = 0; i < BENCH_QUERIES; ++i) {
+        double a = now_seconds();
+        csr_bfs_do(&c, sources[i], order, n, NULL);
+        bench_add(&b, a, now_seconds());
+    }
+    bench_report(&b);
+    bench_init(&b, "csr_bfs_parallel", BENCH_QUERIES);
+    for (int i = 0; i < BENCH_QUERIES; ++i) {
+        double a = now_seconds();
+        csr_bfs_parallel(&c, sources[i], order, n, NULL, 0);
+        bench_add(&b, a, now_seconds());
+    }
+    bench_report(&b);
+    printf("Média de alcançados por BFS: %.0f\n", (double)reached / BENCH_QUERIES);
+    int bad = verify_parallel_bfs(&c, sources, BENCH_QUERIES, order);
+    if (bad != 0) {
+        if (bad < 0) printf("Erro: sem memória na conferência da BFS paralela.\n");
+        csr_free(&c); traversal_ctx_free(&ctx); free(sources); free(order); free_graph(&g);
+        return -1;
+    }
+    printf("BFS paralela conferida com csr_bfs_do (alcançados e níveis, 1-8 threads).\n");
+    bench_init(&b, "csr_triangle_count", 1);
+    double a = now_seconds();
+    long long tri = csr_triangle_count(&c, NULL, 0);
+    bench_add(&b, a, now_seconds());
+    bench_report(&b);
+    printf("Triângulos: %lld\n", tri);
+    CompressedCSR z;
+    bench_init(&b, "compress_graph", 1);
+    a = now_seconds();
+    if (compress_graph(&g, &z) != 0) {
+        free(b.lat); csr_free(&c); traversal_ctx_free(&ctx); free(sources); free(order); free_graph(&g);
+        return -1;
+    }
+    bench_add(&b, a, now_seconds());
+    bench_report(&b);
+    printf("Memória das adjacências: listas %.1f MiB, CSR %.1f MiB, comprimido %.1f MiB (%.2f B/meia-aresta)\n",
+           (double)c.m2 * sizeof(AdjNode) / 1048576.0,
+           ((double)c.m2 + c.n + 1) * sizeof(int) / 1048576.0,
+           (double)zcsr_memory(&z) / 1048576.0, c.m2 ? (double)z.bytes / (double)c.m2 : 0.0);
+    bench_init(&b, "zcsr_bfs_ctx (comprimido)", BENCH_QUERIES);
+    for (int i = 0; i < BENCH_QUERIES; ++i) {
+        a = now_seconds();
+        zcsr_bfs_ctx(&z, &ctx, sources[i], order, n);
+        bench_add(&b, a, now_seconds());
+    }
+    bench_report(&b);
+    bench_init(&b, "csr_common_count", 1000000);
+    for (int i = 0; i < 1000000; ++i) {
+        int u = rng_below(&st, n), v = rng_below(&st, n);
+        a = now_seconds();
+        csr_common_count(&c, u, v);
+        bench_add(&b, a, now_seconds());
+    }
+    bench_report(&b);
+    bench_init(&b, "zcsr_common_count", 1000000);
+    for (int i = 0; i < 1000000; ++i) {
+        int u = rng_below(&st, n), v = rng_below(&st, n);
+        a = now_seconds();
+        zcsr_common_count(&z, u, v);
+        bench_add(&b, a, now_seconds());
+    }
+    bench_report(&b);
+    // caminhos ponderados: pesos uniformes em [1, 10)
+    for (int u = 0; u < n; ++u)
+        for (AdjNode *curr = g.vertices[u].head; curr; curr = curr->next)
+            if (u < curr->v) set_edge_weight_by_index(&g, u, curr->v, 1.0f + (float)rng_below(&st, 9000) / 1000.0f);
+    CSRGraph cw;
+    PathCtx pc;
+    path_ctx_init(&pc);
+    if (freeze_graph(&g, &cw, 1) == 0) {
+        bench_init(&b, "dijkstra_ctx (listas)", BENCH_QUERIES);
+        for (int i = 0; i < BENCH_QUERIES; ++i) {
+            a = now_seconds();
+            dijkstra_ctx(&g, &pc, sources[i], -1);
+            bench_add(&b, a, now_seconds());
         }
-        printf("\n");
+        bench_report(&b);
+        bench_init(&b, "csr_dijkstra_ctx (CSR)", BENCH_QUERIES);
+        for (int i = 0; i < BENCH_QUERIES; ++i) {
+            a = now_seconds();
+            csr_dijkstra_ctx(&cw, &pc, sources[i], -1);
+            bench_add(&b, a, now_seconds());
+        }
+        bench_report(&b);
+        csr_free(&cw);
     }
-}
+    path_ctx_free(&pc);
+    zcsr_free(&z);
+    csr_free(&c);
+    traversal_ctx_free(&ctx);
+    free(sources);
+    free(order);
 
-/* Gera arquivo .dot para Graphviz */
-void generate_dot(Graph *g, const char *filename) {
-    FILE *f = fopen(filename, "w");
-    if (!f) {
-        perror("Erro ao criar .dot");
-        return;
+    // 4) exportação (O(V + E), descartada em /dev/null)
+    bench_init(&b, "export_graph (edges)", 1);
+    a = now_seconds();
+    if (export_graph(&g, "edges", "/dev/null") != 0) printf("Erro ao exportar.\n");
+    bench_add(&b, a, now_seconds());
+    b.ops = added;
+    bench_report(&b);
+
+    // 5) remoções
+    int nrem = n / 10 < 100000 ? n / 10 : 100000;
+    bench_init(&b, "remove_edge_by_index", nrem);
+    for (int i = 0; i < nrem; ++i) {
+        int u = rng_below(&st, g.n);
+        if (!g.vertices[u].head) continue;
+        int v = g.vertices[u].head->v;
+        double t = now_seconds();
+        remove_edge_by_index(&g, u, v);
+        bench_add(&b, t, now_seconds());
     }
-    fprintf(f, "graph RedeAmizades {\n");
-    // imprimir nós com rótulo como nome
-    for (int i = 0; i < g->n; ++i) {
-        fprintf(f, "  v%d [label=\"%s\"];\n", i, g->vertices[i].name);
+    bench_report(&b);
+    bench_init(&b, "remove_vertex_fast", nrem);
+    for (int i = 0; i < nrem && g.n > 1; ++i) {
+        int u = rng_below(&st, g.n);
+        double t = now_seconds();
+        remove_vertex_fast_by_index(&g, u);
+        bench_add(&b, t, now_seconds());
     }
-    // arestas (u < v)
-    for (int u = 0; u < g->n; ++u) {
-        for (int v = u + 1; v < g->n; ++v) {
-            if (g->adjMatrix[u][v]) {
-                fprintf(f, "  v%d -- v%d;\n", u, v);
+    bench_report(&b);
+    int nord = nrem < 20 ? nrem : 20; // remoção ordenada custa O(V + E) cada
+    bench_init(&b, "remove_vertex_by_index", nord);
+    for (int i = 0; i < nord && g.n > 1; ++i) {
+        int u = rng_below(&st, g.n);
+        double t = now_seconds();
+        remove_vertex_by_index(&g, u);
+        bench_add(&b, t, now_seconds());
+    }
+    bench_report(&b);
+
+    printf("Pico de memória (RSS): %.1f MiB\n", peak_rss_mib());
+    free_graph(&g);
+    return 0;
+}
+
+/* Percursos antes e depois de cada reordenação. As pessoas entram em ordem
+   aleatória e as amizades uma a uma (como numa rede que cresce por cadastro);
+   as fontes das BFS são as mesmas pessoas em todas as rodadas (por id).
+   Retorna 0 sucesso, -1 erro. */
+int run_reorder_benchmark(const char *model, int n, long long m, uint64_t seed) {
+    static const char *methods[] = { "inserção", "grau", "bfs", "rcm" };
+    size_t np;
+    int *pairs = generate_edges(model, n, m, seed, &np);
+    if (!pairs) return -1;
+    uint64_t st = seed ^ 0x5DEECE66DULL;
+    int *arrival = malloc(sizeof(int) * (size_t)n);  // arrival[rótulo] = índice de chegada
+    int *order = malloc(sizeof(int) * (size_t)n);
+    int sources[BENCH_QUERIES];
+    if (!arrival || !order) { free(pairs); free(arrival); free(order); return -1; }
+    for (int i = 0; i < n; ++i) arrival[i] = i;
+    for (int i = n - 1; i > 0; --i) {
+        int j = rng_below(&st, i + 1), t = arrival[i];
+        arrival[i] = arrival[j];
+        arrival[j] = t;
+    }
+    for (size_t i = 0; i < 2 * np; ++i) pairs[i] = arrival[pairs[i]];
+    for (int i = 0; i < BENCH_QUERIES; ++i) sources[i] = rng_below(&st, n); // ids
+    printf("Modelo %s: %d vértices, %zu pares (semente %llu)\n",
+           model, n, np, (unsigned long long)seed);
+
+    double base_list = 0.0, base_csr = 0.0;
+    char name[48];
+    int r = 0;
+    for (int method = -1; method <= REORDER_RCM && r == 0; ++method) {
+        Graph g;
+        init_graph(&g);
+        graph_reserve(&g, n);
+        for (int i = 0; i < n && r == 0; ++i) {
+            snprintf(name, sizeof(name), "p%d", i);
+            if (add_vertex(&g, name) != 0) r = -1;
+        }
+        for (size_t i = 0; i < np && r == 0; ++i) add_edge_by_index(&g, pairs[2 * i], pairs[2 * i + 1]);
+        double t0 = now_seconds();
+        if (r == 0 && method >= 0 && graph_reorder(&g, method) != 0) r = -1;
+        double t_reorder = now_seconds() - t0;
+        CSRGraph c;
+        if (r != 0 || freeze_graph(&g, &c, 1) != 0) { free_graph(&g); r = -1; break; }
+        printf("\n[%s] reordenação %.3f s, distância média entre vizinhos %.0f\n",
+               methods[method + 1], t_reorder, graph_mean_gap(&g));
+        TraversalCtx ctx;
+        traversal_ctx_init(&ctx);
+        BenchStat b;
+        snprintf(name, sizeof(name), "bfs_ctx (listas)");
+        bench_init(&b, name, BENCH_QUERIES);
+        for (int i = 0; i < BENCH_QUERIES; ++i) {
+            double a = now_seconds();
+            bfs_ctx(&g, &ctx, vertex_index_by_id(&g, sources[i]), order, n);
+            bench_add(&b, a, now_seconds());
+        }
+        double list = b.seconds;
+        bench_report(&b);
+        snprintf(name, sizeof(name), "csr_bfs_ctx (CSR)");
+        bench_init(&b, name, BENCH_QUERIES);
+        for (int i = 0; i < BENCH_QUERIES; ++i) {
+            double a = now_seconds();
+            csr_bfs_ctx(&c, &ctx, vertex_index_by_id(&g, sources[i]), order, n);
+            bench_add(&b, a, now_seconds());
+        }
+        double csr = b.seconds;
+        bench_report(&b);
+        CompressedCSR z;
+        if (compress_graph(&g, &z) == 0) {
+            snprintf(name, sizeof(name), "zcsr_bfs_ctx (comprimido)");
+            bench_init(&b, name, BENCH_QUERIES);
+            for (int i = 0; i < BENCH_QUERIES; ++i) {
+                double a = now_seconds();
+                zcsr_bfs_ctx(&z, &ctx, vertex_index_by_id(&g, sources[i]), order, n);
+                bench_add(&b, a, now_seconds());
             }
+            bench_report(&b);
+            printf("CSR comprimido: %.2f B/meia-aresta\n", z.m2 ? (double)z.bytes / (double)z.m2 : 0.0);
+            zcsr_free(&z);
         }
+        if (method < 0) { base_list = list; base_csr = csr; }
+        else printf("Aceleração: listas %.2fx, CSR %.2fx\n",
+                    list > 0 ? base_list / list : 0.0, csr > 0 ? base_csr / csr : 0.0);
+        traversal_ctx_free(&ctx);
+        csr_free(&c);
+        free_graph(&g);
     }
-    fprintf(f, "}\n");
-    fclose(f);
-    printf("\nArquivo '%s' gerado. Visualize com: dot -Tpng %s -o grafo.png\n", filename, filename);
+    free(pairs);
+    free(arrival);
+    free(order);
+    return r;
 }
 
-/* ----- Percursos ----- */
+/* Compara a BFS particionada em nshards com a BFS no grafo único */
+int run_shard_benchmark(const char *model, int n, long long m, int nshards, uint64_t seed) {
+    if (nshards < 1) return -1;
+    size_t np;
+    int *pairs = generate_edges(model, n, m, seed, &np);
+    if (!pairs) return -1;
+    uint64_t st = seed ^ 0x5DEECE66DULL;
+    int *order = malloc(sizeof(int) * (size_t)n);
+    int sources[BENCH_QUERIES];
+    if (!order) { free(pairs); return -1; }
+    for (int i = 0; i < BENCH_QUERIES; ++i) sources[i] = rng_below(&st, n);
+    printf("Modelo %s: %d vértices, %zu pares, %d shards (semente %llu)\n",
+           model, n, np, nshards, (unsigned long long)seed);
 
-/* Fila simples para BFS */
-typedef struct {
-    int *data;
-    int head, tail, cap;
-} Queue;
+    Graph g;
+    init_graph(&g);
+    graph_reserve(&g, n);
+    char name[48];
+    int r = 0;
+    for (int i = 0; i < n && r == 0; ++i) {
+        snprintf(name, sizeof(name), "p%d", i);
+        if (add_vertex(&g, name) != 0) r = -1;
+    }
+    if (r == 0) add_edges_batch(&g, pairs, np);
+    ShardedGraph sg;
+    double t0 = now_seconds();
+    if (r != 0 || sharded_init(&sg, nshards) != 0) { free_graph(&g); free(pairs); free(order); return -1; }
+    if (sharded_from_graph(&sg, &g) != 0) r = -1;
+    double t_part = now_seconds() - t0;
+    if (r == 0) {
+        long long ghosts = 0;
+        int min_own = INT_MAX, max_own = 0;
+        for (int s = 0; s < nshards; ++s) {
+            int own = 0;
+            for (int i = 0; i < sg.shards[s].g.n; ++i)
+                if (shard_is_ghost(&sg.shards[s], i)) ghosts++; else own++;
+            if (own < min_own) min_own = own;
+            if (own > max_own) max_own = own;
+        }
+        long long cut = sharded_edge_cut(&sg), edges = 0;
+        for (int u = 0; u < g.n; ++u) edges += g.vertices[u].degree;
+        edges /= 2;
+        printf("Particionamento %.3f s: corte %lld de %lld arestas (%.1f%%), %lld fantasmas, "
+               "vértices por shard %d..%d\n", t_part, cut, edges,
+               edges ? 100.0 * (double)cut / (double)edges : 0.0, ghosts, min_own, max_own);
 
-Queue *queue_create(int cap) {
-    Queue *q = malloc(sizeof(Queue));
-    q->data = malloc(sizeof(int) * cap);
-    q->head = q->tail = 0;
-    q->cap = cap;
-    return q;
-}
-void queue_free(Queue *q) { free(q->data); free(q); }
-int queue_empty(Queue *q) { return q->head == q->tail; }
-void queue_push(Queue *q, int x) { q->data[q->tail++] = x; }
-int queue_pop(Queue *q) { return q->data[q->head++]; }
+        TraversalCtx ctx;
+        traversal_ctx_init(&ctx);
+        BenchStat b;
+        bench_init(&b, "bfs_ctx (grafo único)", BENCH_QUERIES);
+        for (int i = 0; i < BENCH_QUERIES; ++i) {
+            double a = now_seconds();
+            bfs_ctx(&g, &ctx, sources[i], order, n);
+            bench_add(&b, a, now_seconds());
+        }
+        bench_report(&b);
+        traversal_ctx_free(&ctx);
 
-/* BFS: imprime ordem de visita e retorna número de visitados */
-int bfs(Graph *g, int start, int *visited_order, int max_out) {
-    if (start < 0 || start >= g->n) return 0;
-    int *visited = calloc(g->n, sizeof(int));
-    Queue *q = queue_create(g->n + 5);
-    visited[start] = 1;
-    queue_push(q, start);
-    int count = 0;
-    while (!queue_empty(q)) {
-        int u = queue_pop(q);
-        if (count < max_out) visited_order[count] = u;
-        count++;
-        AdjNode *curr = g->vertices[u].head;
-        while (curr) {
-            int v = curr->v;
-            if (!visited[v]) {
-                visited[v] = 1;
-                queue_push(q, v);
-            }
-            curr = curr->next;
+        ShardBFSStats stats, total = {0, 0, 0, 0};
+        bench_init(&b, "sharded_bfs (particionado)", BENCH_QUERIES);
+        for (int i = 0; i < BENCH_QUERIES && r == 0; ++i) {
+            snprintf(name, sizeof(name), "p%d", sources[i]);
+            double a = now_seconds();
+            if (sharded_bfs(&sg, name, &stats) != 0) r = -1;
+            bench_add(&b, a, now_seconds());
+            total.reached += stats.reached;
+            total.depth += stats.depth;
+            total.messages += stats.messages;
+            total.ids_sent += stats.ids_sent;
         }
+        bench_report(&b);
+        printf("Por BFS: %.0f alcançados, %.1f níveis, %.1f mensagens, %.0f ids enviados\n",
+               (double)total.reached / BENCH_QUERIES, (double)total.depth / BENCH_QUERIES,
+               (double)total.messages / BENCH_QUERIES, (double)total.ids_sent / BENCH_QUERIES);
     }
-    free(visited);
-    queue_free(q);
-    return count;
+    sharded_free(&sg);
+    free_graph(&g);
+    free(pairs);
+    free(order);
+    return r;
 }
 
-/* DFS recursiva (registro de ordem) */
-void dfs_util(Graph *g, int u, int *visited, int *order, int *pos) {
-    visited[u] = 1;
-    order[(*pos)++] = u;
-    AdjNode *curr = g->vertices[u].head;
-    while (curr) {
-        if (!visited[curr->v]) dfs_util(g, curr->v, visited, order, pos);
-        curr = curr->next;
+#define RCU_BENCH_PUBLISH 1024  // mutações entre publicações no benchmark RCU
+
+typedef struct {
+    ConcurrentGraph *cg;
+    atomic_int *stop;
+    uint64_t seed;
+    long long queries, reached, errors;
+} RcuBenchReader;
+
+/* Confere a versão lida nos vértices sample[0..k): nome "p<id>" (como o
+   escritor do benchmark cria), vizinhos no intervalo e arestas simétricas */
+static int rcu_bench_check(const GraphVersion *ver, const int *sample, int k) {
+    for (int i = 0; i < k; ++i) {
+        int u = sample[i];
+        const char *name = version_name(ver, u);
+        if (!name || name[0] != 'p' || atoi(name + 1) != version_id(ver, u)) return 0;
+        const int *blk = ver->adj[u];
+        for (int j = 1; blk && j <= blk[0] && j <= 8; ++j) {
+            int v = blk[j], found = 0;
+            if (v < 0 || v >= ver->n || !ver->adj[v]) return 0;
+            for (int x = 1; x <= ver->adj[v][0] && !found; ++x) found = ver->adj[v][x] == u;
+            if (!found) return 0;
+        }
     }
-}
-int dfs(Graph *g, int start, int *order, int max_out) {
-    if (start < 0 || start >= g->n) return 0;
-    int *visited = calloc(g->n, sizeof(int));
-    int pos = 0;
-    dfs_util(g, start, visited, order, &pos);
-    free(visited);
-    return pos;
+    return 1;
 }
 
-/* ----- Grafo de exemplo (pré-definido) ----- */
-void insert_sample_graph(Graph *g) {
-    // nomes simples
-    const char *names[] = {"Alice", "Bob", "Carol", "Dave", "Eve", "Frank"};
-    int cnt = sizeof(names)/sizeof(names[0]);
-    for (int i = 0; i < cnt; ++i) add_vertex(g, names[i]);
-    add_edge(g, "Alice", "Bob");
-    add_edge(g, "Alice", "Carol");
-    add_edge(g, "Bob", "Dave");
-    add_edge(g, "Carol", "Eve");
-    add_edge(g, "Eve", "Frank");
-    add_edge(g, "Bob", "Carol");
-    add_edge(g, "Dave", "Frank");
-    printf("Grafo de exemplo inserido (%d vértices).\n", g->n);
+/* Leitor: BFS a partir de vértices aleatórios da versão atual até stop */
+static void *rcu_bench_reader(void *p) {
+    RcuBenchReader *r = p;
+    int slot = cgraph_reader_register(r->cg);
+    if (slot < 0) { r->errors++; return NULL; }
+    TraversalCtx ctx;
+    traversal_ctx_init(&ctx);
+    int *order = NULL, cap = 0;
+    uint64_t st = r->seed;
+    while (!atomic_load(r->stop)) {
+        const GraphVersion *ver = cgraph_read_begin(r->cg, slot);
+        if (ver->n > cap) {
+            int *no = realloc(order, sizeof(int) * (size_t)ver->n);
+            if (!no) { cgraph_read_end(r->cg, slot); r->errors++; break; }
+            order = no;
+            cap = ver->n;
+        }
+        if (ver->n > 0) {
+            int count = version_bfs(ver, &ctx, rng_below(&st, ver->n), order, ver->n);
+            r->errors += !rcu_bench_check(ver, order, count < 16 ? count : 16);
+            r->reached += count;
+            r->queries++;
+        }
+        cgraph_read_end(r->cg, slot);
+    }
+    cgraph_reader_unregister(r->cg, slot);
+    traversal_ctx_free(&ctx);
+    free(order);
+    return NULL;
 }
 
-/* ----- Limpeza final ----- */
-void free_graph(Graph *g) {
-    for (int i = 0; i < g->n; ++i) {
-        free_adj_list(g->vertices[i].head);
-        free(g->vertices[i].name);
-        g->vertices[i].head = NULL;
-        g->vertices[i].name = NULL;
+/* Um escritor (a thread chamadora) insere as arestas geradas, remove
+   algumas arestas e pessoas e publica a cada RCU_BENCH_PUBLISH mutações,
+   enquanto nreaders leitores fazem BFS nas versões publicadas. No fim a
+   última versão é comparada com o grafo do escritor. */
+int run_rcu_benchmark(const char *model, int n, long long m, int nreaders, uint64_t seed) {
+    if (nreaders < 1 || nreaders >= RCU_MAX_READERS) return -1;
+    size_t np;
+    int *pairs = generate_edges(model, n, m, seed, &np);
+    if (!pairs) return -1;
+    printf("Modelo %s: %d vértices, %zu pares, %d leitor(es) (semente %llu)\n",
+           model, n, np, nreaders, (unsigned long long)seed);
+    ConcurrentGraph cg;
+    if (cgraph_init(&cg) != 0) { free(pairs); return -1; }
+    char a[32], b[32];
+    int r = 0;
+    for (int i = 0; i < n && r == 0; ++i) {
+        snprintf(a, sizeof(a), "p%d", i); // id = i: nomes "p<id>"
+        if (cgraph_add_vertex(&cg, a) != 0) r = -1;
     }
-    g->n = 0;
+    if (r == 0) r = cgraph_publish(&cg);
+    atomic_int stop;
+    atomic_init(&stop, 0);
+    pthread_t *th = malloc(sizeof(pthread_t) * (size_t)nreaders);
+    RcuBenchReader *rd = calloc((size_t)nreaders, sizeof(RcuBenchReader));
+    if (r != 0 || !th || !rd) { free(th); free(rd); free(pairs); cgraph_free(&cg); return -1; }
+    for (int i = 0; i < nreaders; ++i) {
+        rd[i].cg = &cg;
+        rd[i].stop = &stop;
+        rd[i].seed = seed + 0x9E3779B97F4A7C15ULL * (uint64_t)(i + 1);
+        if (pthread_create(&th[i], NULL, rcu_bench_reader, &rd[i]) != 0) {
+            fprintf(stderr, "Erro: não foi possível criar thread.\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+    uint64_t st = seed ^ 0x5DEECE66DULL;
+    long long muts = 0, publishes = 1;
+    double t0 = now_seconds();
+    for (size_t i = 0; i < np && r == 0; ++i) {
+        snprintf(a, sizeof(a), "p%d", pairs[2 * i]);
+        snprintf(b, sizeof(b), "p%d", pairs[2 * i + 1]);
+        cgraph_add_edge(&cg, a, b);
+        if (i % 16 == 15) { // remove uma aresta já inserida
+            size_t j = (size_t)rng_below(&st, (int)(i + 1 < INT_MAX ? i + 1 : INT_MAX));
+            snprintf(a, sizeof(a), "p%d", pairs[2 * j]);
+            snprintf(b, sizeof(b), "p%d", pairs[2 * j + 1]);
+            cgraph_remove_edge(&cg, a, b);
+            muts++;
+        }
+        if (i % 256 == 255 && cg.g.n > 1) { // troca uma pessoa por outra nova
+            int id = cg.g.next_id; // só este escritor muda o grafo
+            cgraph_remove_vertex(&cg, vertex_name(&cg.g, rng_below(&st, cg.g.n)));
+            snprintf(a, sizeof(a), "p%d", id);
+            cgraph_add_vertex(&cg, a);
+            muts += 2;
+        }
+        if (++muts % RCU_BENCH_PUBLISH == 0) {
+            if (cgraph_publish(&cg) != 0) r = -1;
+            publishes++;
+        }
+    }
+    if (r == 0 && cgraph_publish(&cg) != 0) r = -1;
+    double dt = now_seconds() - t0;
+    atomic_store(&stop, 1);
+    long long queries = 0, reached = 0, errors = 0;
+    for (int i = 0; i < nreaders; ++i) {
+        pthread_join(th[i], NULL);
+        queries += rd[i].queries;
+        reached += rd[i].reached;
+        errors += rd[i].errors;
+    }
+    // a última versão tem que refletir exatamente o grafo do escritor
+    const GraphVersion *ver = atomic_load(&cg.current);
+    long long mismatches = ver->n != cg.g.n;
+    for (int u = 0; u < ver->n && u < cg.g.n; ++u)
+        mismatches += version_degree(ver, u) != cg.g.vertices[u].degree || ver->ids[u] != cg.g.vertices[u].id ||
+                      strcmp(ver->names[u], vertex_name(&cg.g, u)) != 0;
+    printf("Escritor: %lld mutações em %.3f s (%.0f/s), %lld publicações\n",
+           muts, dt, dt > 0 ? (double)muts / dt : 0.0, publishes + 1);
+    printf("Leitores: %lld BFS (%.0f/s), %.0f alcançados em média\n",
+           queries, dt > 0 ? (double)queries / dt : 0.0, queries ? (double)reached / (double)queries : 0.0);
+    printf("Conferência: %lld versão(ões) lidas inconsistentes, %lld vértice(s) divergentes na última\n",
+           errors, mismatches);
+    free(th);
+    free(rd);
+    free(pairs);
+    cgraph_free(&cg);
+    return r == 0 && errors == 0 && mismatches == 0 ? 0 : -1;
 }
 
 /* ----- Menu e interação (entrada segura de strings) ----- */
@@ -469,11 +6191,184 @@ void menu() {
     printf("8 - Inserir grafo de exemplo\n");
     printf("9 - Gerar arquivo grafo.dot (Graphviz)\n");
     printf("10 - Visualização ASCII\n");
+    printf("11 - Vizinhança de k saltos (amigos de amigos com k = 2)\n");
+    printf("12 - Menor caminho entre duas pessoas\n");
+    printf("13 - Salvar snapshot binário (grafo.bin)\n");
+    printf("14 - Carregar snapshot binário (grafo.bin)\n");
+    printf("15 - Importar lista de arestas (CSV/TSV)\n");
+    printf("16 - Exportar grafo (dot, edges, tsv, adj)\n");
+    printf("17 - Componentes conexas (verificar se duas pessoas estão ligadas)\n");
+    printf("18 - Amigos em comum e coeficiente de agrupamento\n");
+    printf("19 - Sugestões de amizade (pessoas que você talvez conheça)\n");
+    printf("20 - Estatísticas de instrumentação (e zerar contadores)\n");
+    printf("21 - Pessoas mais conectadas e histograma de graus\n");
+    printf("22 - Reordenar vértices para localidade (grau, BFS, RCM)\n");
+    printf("23 - Definir peso de uma amizade (força da interação)\n");
+    printf("24 - Menor caminho ponderado entre duas pessoas (Dijkstra)\n");
     printf("0 - Sair\n");
     printf("Escolha: ");
 }
 
-int main() {
+/* Modo não interativo: --import arquivo [snapshot.bin] */
+static int run_import(const char *edges, const char *snapshot) {
+    Graph g;
+    init_graph(&g);
+    ImportStats st;
+    int r = import_edge_list(&g, edges, &st);
+    if (r == 0) {
+        print_import_stats(&st);
+        printf("Grafo: %d vértices\n", g.n);
+        if (snapshot) {
+            if (save_snapshot(&g, snapshot) == 0) printf("Snapshot '%s' gravado.\n", snapshot);
+            else { fprintf(stderr, "Erro ao gravar '%s'.\n", snapshot); r = -1; }
+        }
+    } else {
+        fprintf(stderr, "Erro ao importar '%s'.\n", edges);
+    }
+    free_graph(&g);
+    return r == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/* Modo não interativo: --query snapshot.bin pessoa [outra]
+   Consulta somente leitura direto sobre o arquivo mapeado: nada é copiado
+   nem reconstruído, então o processo responde logo após o mmap. */
+static int run_query(const char *snapshot, const char *name, const char *other) {
+    GraphSnapshot snap;
+    if (load_snapshot(snapshot, &snap) != 0) {
+        fprintf(stderr, "Erro ao carregar '%s'.\n", snapshot);
+        return EXIT_FAILURE;
+    }
+    int r = -1;
+    int u = snapshot_find(&snap, name);
+    int v = other ? snapshot_find(&snap, other) : -1;
+    int *order = malloc(sizeof(int) * (size_t)(snap.csr.n > 0 ? snap.csr.n : 1));
+    int *level = malloc(sizeof(int) * (size_t)(snap.csr.n > 0 ? snap.csr.n : 1));
+    if (u == -1 || (other && v == -1)) {
+        fprintf(stderr, "Pessoa '%s' não encontrada.\n", u == -1 ? name : other);
+    } else if (!order || !level) {
+        fprintf(stderr, "Erro: sem memória.\n");
+    } else {
+        int reached = csr_bfs_do(&snap.csr, u, order, snap.csr.n, level);
+        printf("%s: %d amigo(s), alcança %d pessoa(s)\n", name, csr_degree(&snap.csr, u), reached - 1);
+        if (other) {
+            if (level[v] < 0) printf("%s e %s não estão conectados\n", name, other);
+            else printf("Distância de %s a %s: %d\n", name, other, level[v]);
+        }
+        r = 0;
+    }
+    free(order);
+    free(level);
+    snapshot_close(&snap);
+    return r == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/* Modo não interativo: --export formato arestas.csv [saida] */
+static int run_export(const char *fmt, const char *edges, const char *out) {
+    Graph g;
+    init_graph(&g);
+    ImportStats st;
+    int r = import_edge_list(&g, edges, &st);
+    if (r != 0) fprintf(stderr, "Erro ao importar '%s'.\n", edges);
+    else if ((r = export_graph(&g, fmt, out)) != 0) fprintf(stderr, "Erro ao exportar para '%s'.\n", out);
+    free_graph(&g);
+    return r == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/* Modo não interativo: --batch [comandos|-] [saida|-] */
+static int run_batch(const char *in_name, const char *out_name) {
+    FILE *in = strcmp(in_name, "-") == 0 ? stdin : fopen(in_name, "rb");
+    if (!in) { fprintf(stderr, "Erro ao abrir '%s'.\n", in_name); return EXIT_FAILURE; }
+    FILE *out = strcmp(out_name, "-") == 0 ? stdout : fopen(out_name, "w");
+    if (!out) {
+        fprintf(stderr, "Erro ao criar '%s'.\n", out_name);
+        if (in != stdin) fclose(in);
+        return EXIT_FAILURE;
+    }
+    Graph g;
+    init_graph(&g);
+    long long commands = 0, errors = 0;
+    double t0 = now_seconds();
+    int r = run_batch_commands(&g, in, out, &commands, &errors);
+    double dt = now_seconds() - t0;
+    if (in != stdin) fclose(in);
+    if (out != stdout && fclose(out) != 0) r = -1;
+    fprintf(stderr, "Lote: %lld comandos, %lld erros, %.3f s (%.0f comandos/s)\n",
+            commands, errors, dt, dt > 0 ? (double)commands / dt : 0.0);
+    if (r != 0) fprintf(stderr, "Erro: sem memória ou falha de leitura/escrita.\n");
+    free_graph(&g);
+    return r == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/* Modo não interativo: --durable snapshot.bin log.wal [comandos|-] [saida|-]
+   Recupera (snapshot + cauda do log), executa os comandos registrando as
+   mutações e faz o commit do último grupo. */
+static int run_durable(const char *snapshot, const char *wal, const char *in_name, const char *out_name) {
+    DurableGraph d;
+    long long replayed;
+    double t0 = now_seconds();
+    if (durable_open(&d, snapshot, wal, WAL_GROUP_OPS, &replayed) != 0) {
+        fprintf(stderr, "Erro ao recuperar '%s' + '%s'.\n", snapshot, wal);
+        return EXIT_FAILURE;
+    }
+    fprintf(stderr, "Recuperado: %d vértices, %lld registro(s) do log reaplicados em %.3f s\n",
+            d.g.n, replayed, now_seconds() - t0);
+    FILE *in = strcmp(in_name, "-") == 0 ? stdin : fopen(in_name, "rb");
+    FILE *out = strcmp(out_name, "-") == 0 ? stdout : fopen(out_name, "w");
+    if (!in || !out) {
+        fprintf(stderr, "Erro ao abrir '%s'.\n", !in ? in_name : out_name);
+        if (in && in != stdin) fclose(in);
+        durable_close(&d);
+        return EXIT_FAILURE;
+    }
+    long long commands = 0, errors = 0;
+    t0 = now_seconds();
+    int r = run_durable_commands(&d, in, out, &commands, &errors);
+    double dt = now_seconds() - t0;
+    if (in != stdin) fclose(in);
+    if (out != stdout && fclose(out) != 0) r = -1;
+    long long commits = d.wal.commits;
+    if (durable_close(&d) != 0) r = -1;
+    fprintf(stderr, "Lote: %lld comandos, %lld erros, %lld commit(s) do log, %.3f s (%.0f comandos/s)\n",
+            commands, errors, commits, dt, dt > 0 ? (double)commands / dt : 0.0);
+    if (r != 0) fprintf(stderr, "Erro: sem memória ou falha de leitura/escrita.\n");
+    return r == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/* Modo não interativo: --bench|--bench-reorder modelo V E [semente],
+   --bench-shards modelo V E shards [semente] ou --bench-rcu modelo V E leitores [semente] */
+static int run_bench(int argc, char **argv) {
+    int n = atoi(argv[3]);
+    long long m = atoll(argv[4]);
+    int shards = strcmp(argv[1], "--bench-shards") == 0, rcu = strcmp(argv[1], "--bench-rcu") == 0;
+    if ((shards || rcu) && argc < 6) return EXIT_FAILURE;
+    int seed_arg = shards || rcu ? 6 : 5;
+    uint64_t seed = argc > seed_arg ? strtoull(argv[seed_arg], NULL, 10) : 42;
+    int r = shards ? run_shard_benchmark(argv[2], n, m, atoi(argv[5]), seed)
+          : rcu ? run_rcu_benchmark(argv[2], n, m, atoi(argv[5]), seed)
+          : strcmp(argv[1], "--bench") == 0 ? run_benchmark(argv[2], n, m, seed)
+                                            : run_reorder_benchmark(argv[2], n, m, seed);
+    if (r != 0) {
+        fprintf(stderr, "Erro no benchmark (modelo rmat|ba|er, V >= 2, E >= 0).\n");
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
+
+int main(int argc, char **argv) {
+    if (argc >= 2 && strcmp(argv[1], "--batch") == 0)
+        return run_batch(argc >= 3 ? argv[2] : "-", argc >= 4 ? argv[3] : "-");
+    if (argc >= 4 && strcmp(argv[1], "--durable") == 0)
+        return run_durable(argv[2], argv[3], argc >= 5 ? argv[4] : "-", argc >= 6 ? argv[5] : "-");
+    if (argc >= 5 && (strcmp(argv[1], "--bench") == 0 || strcmp(argv[1], "--bench-reorder") == 0 ||
+                      strcmp(argv[1], "--bench-shards") == 0 || strcmp(argv[1], "--bench-rcu") == 0))
+        return run_bench(argc, argv);
+    if (argc >= 3 && strcmp(argv[1], "--import") == 0)
+        return run_import(argv[2], argc >= 4 ? argv[3] : NULL);
+    if (argc >= 4 && strcmp(argv[1], "--query") == 0)
+        return run_query(argv[2], argv[3], argc >= 5 ? argv[4] : NULL);
+    if (argc >= 4 && strcmp(argv[1], "--export") == 0)
+        return run_export(argv[2], argv[3], argc >= 5 ? argv[4] : "-");
+
     Graph g;
     init_graph(&g);
 
@@ -492,7 +6387,7 @@ int main() {
             if (strlen(name) == 0) { printf("Nome vazio. Cancelado.\n"); continue; }
             int r = add_vertex(&g, name);
             if (r == 0) printf("Pessoa '%s' adicionada (indice %d).\n", name, g.n - 1);
-            else if (r == -1) printf("Erro: limite de vértices alcançado (%d).\n", MAX_VERTICES);
+            else if (r == -1) printf("Erro: sem memória para nova pessoa.\n");
             else if (r == -2) printf("Erro: já existe pessoa com esse nome.\n");
         }
         else if (option == 2) {
@@ -535,15 +6430,17 @@ int main() {
             read_line(name, NAME_LEN);
             int idx = find_vertex_index(&g, name);
             if (idx == -1) { printf("Pessoa nao encontrada.\n"); continue; }
-            int order[MAX_VERTICES];
-            int visited_count = bfs(&g, idx, order, MAX_VERTICES);
+            int *order = malloc(sizeof(int) * (size_t)g.n);
+            if (!order) { printf("Erro: sem memória.\n"); continue; }
+            int visited_count = bfs(&g, idx, order, g.n);
             printf("Ordem de visita BFS (a partir de %s):\n", name);
-            if (visited_count == 0) { printf("(nenhum)\n"); continue; }
-            for (int i = 0; i < visited_count && i < MAX_VERTICES; ++i) {
+            if (visited_count == 0) { printf("(nenhum)\n"); free(order); continue; }
+            for (int i = 0; i < visited_count && i < g.n; ++i) {
                 int id = order[i];
-                printf(" %d: %s\n", id, g.vertices[id].name);
+                printf(" %d: %s\n", id, vertex_name(&g, id));
             }
             printf("Total visitados: %d\n", visited_count);
+            free(order);
         }
         else if (option == 7) {
             char name[NAME_LEN];
@@ -551,13 +6448,15 @@ int main() {
             read_line(name, NAME_LEN);
             int idx = find_vertex_index(&g, name);
             if (idx == -1) { printf("Pessoa nao encontrada.\n"); continue; }
-            int order[MAX_VERTICES];
-            int visited_count = dfs(&g, idx, order, MAX_VERTICES);
+            int *order = malloc(sizeof(int) * (size_t)g.n);
+            if (!order) { printf("Erro: sem memória.\n"); continue; }
+            int visited_count = dfs(&g, idx, order, g.n);
             printf("Ordem de visita DFS (a partir de %s):\n", name);
             for (int i = 0; i < visited_count; ++i) {
-                printf(" %d: %s\n", order[i], g.vertices[order[i]].name);
+                printf(" %d: %s\n", order[i], vertex_name(&g, order[i]));
             }
             printf("Total visitados: %d\n", visited_count);
+            free(order);
         }
         else if (option == 8) {
             insert_sample_graph(&g);
@@ -568,6 +6467,212 @@ int main() {
         else if (option == 10) {
             ascii_visual(&g);
         }
+        else if (option == 11) {
+            char name[NAME_LEN], kbuf[16];
+            printf("Nome da pessoa: ");
+            read_line(name, NAME_LEN);
+            int idx = find_vertex_index(&g, name);
+            if (idx == -1) { printf("Pessoa nao encontrada.\n"); continue; }
+            printf("Número de saltos (k): ");
+            read_line(kbuf, sizeof(kbuf));
+            int k = atoi(kbuf);
+            if (k < 1) { printf("k inválido.\n"); continue; }
+            int *out = malloc(sizeof(int) * (size_t)g.n);
+            if (!out) { printf("Erro: sem memória.\n"); continue; }
+            TraversalCtx ctx;
+            traversal_ctx_init(&ctx);
+            int found = khop_ctx(&g, &ctx, idx, k, k, out, g.n);
+            printf("Pessoas a exatamente %d salto(s) de %s:\n", k, name);
+            if (found == 0) printf("(nenhuma)\n");
+            for (int i = 0; i < found; ++i) printf(" %d: %s\n", out[i], vertex_name(&g, out[i]));
+            free(out);
+            traversal_ctx_free(&ctx);
+        }
+        else if (option == 12) {
+            char a[NAME_LEN], b[NAME_LEN];
+            printf("Nome da pessoa 1: ");
+            read_line(a, NAME_LEN);
+            printf("Nome da pessoa 2: ");
+            read_line(b, NAME_LEN);
+            int *path = malloc(sizeof(int) * (size_t)(g.n > 0 ? g.n : 1));
+            if (!path) { printf("Erro: sem memória.\n"); continue; }
+            int len = shortest_path(&g, a, b, path, g.n);
+            if (len == -1) printf("Não há caminho (verifique nomes).\n");
+            else {
+                printf("Menor caminho (%d salto(s)): ", len - 1);
+                for (int i = 0; i < len; ++i) printf("%s%s", vertex_name(&g, path[i]), i + 1 < len ? " -> " : "\n");
+            }
+            free(path);
+        }
+        else if (option == 13) {
+            if (save_snapshot(&g, "grafo.bin") == 0) printf("Snapshot 'grafo.bin' gravado (%d vértices).\n", g.n);
+            else printf("Erro ao gravar snapshot.\n");
+        }
+        else if (option == 14) {
+            GraphSnapshot snap;
+            if (load_snapshot("grafo.bin", &snap) != 0) { printf("Erro ao carregar 'grafo.bin'.\n"); continue; }
+            free_graph(&g);
+            init_graph(&g);
+            if (graph_from_snapshot(&g, &snap) == 0) printf("Snapshot carregado (%d vértices).\n", g.n);
+            else printf("Erro ao reconstruir o grafo (sem memória ou ids repetidos).\n");
+            snapshot_close(&snap);
+        }
+        else if (option == 15) {
+            char path[256];
+            printf("Arquivo de arestas: ");
+            read_line(path, sizeof(path));
+            ImportStats st;
+            if (import_edge_list(&g, path, &st) == 0) print_import_stats(&st);
+            else printf("Erro ao importar '%s'.\n", path);
+        }
+        else if (option == 16) {
+            char fmt[16], path[256];
+            printf("Formato (dot, edges, tsv, adj): ");
+            read_line(fmt, sizeof(fmt));
+            printf("Arquivo de saída (- para a tela): ");
+            read_line(path, sizeof(path));
+            if (export_graph(&g, fmt, path) == 0) printf("\nExportação concluída.\n");
+            else printf("Erro ao exportar (verifique formato/arquivo).\n");
+        }
+        else if (option == 17) {
+            int count = component_count(&g);
+            if (count < 0) { printf("Erro: sem memória.\n"); continue; }
+            int largest = 0;
+            for (int i = 0; i < g.n; ++i)
+                if (g.uf.parent[i] == i && g.uf.size[i] > largest) largest = g.uf.size[i];
+            printf("Componentes conexas: %d (maior com %d pessoa(s)).\n", count, largest);
+            char a[NAME_LEN], b[NAME_LEN];
+            printf("Nome da pessoa 1: ");
+            read_line(a, NAME_LEN);
+            printf("Nome da pessoa 2: ");
+            read_line(b, NAME_LEN);
+            int r = connected(&g, a, b);
+            if (r == -1) printf("Pessoa nao encontrada.\n");
+            else printf("'%s' e '%s' %sestão na mesma componente.\n", a, b, r ? "" : "não ");
+        }
+        else if (option == 18) {
+            char a[NAME_LEN], b[NAME_LEN];
+            printf("Nome da pessoa 1: ");
+            read_line(a, NAME_LEN);
+            printf("Nome da pessoa 2: ");
+            read_line(b, NAME_LEN);
+            int u = find_vertex_index(&g, a), v = find_vertex_index(&g, b);
+            if (u == -1 || v == -1) { printf("Pessoa nao encontrada.\n"); continue; }
+            CSRGraph c;
+            long long *tri = malloc(sizeof(long long) * (size_t)g.n);
+            int *out = malloc(sizeof(int) * (size_t)g.n);
+            if (!tri || !out || freeze_graph(&g, &c, 1) != 0) {
+                printf("Erro: sem memória.\n");
+                free(tri); free(out);
+                continue;
+            }
+            int common = csr_common_neighbors(&c, u, v, out, g.n);
+            printf("Amigos em comum de %s e %s: %d\n", a, b, common);
+            for (int i = 0; i < common; ++i) printf(" %d: %s\n", out[i], vertex_name(&g, out[i]));
+            long long total = csr_triangle_count(&c, tri, 0);
+            printf("Triângulos no grafo: %lld\n", total);
+            printf("Agrupamento de %s: %.3f | %s: %.3f\n",
+                   a, clustering_coefficient(csr_degree(&c, u), tri[u]),
+                   b, clustering_coefficient(csr_degree(&c, v), tri[v]));
+            csr_free(&c);
+            free(tri);
+            free(out);
+        }
+        else if (option == 19) {
+            char name[NAME_LEN], kbuf[16], mbuf[16];
+            printf("Nome da pessoa: ");
+            read_line(name, NAME_LEN);
+            int idx = find_vertex_index(&g, name);
+            if (idx == -1) { printf("Pessoa nao encontrada.\n"); continue; }
+            printf("Quantas sugestões (k): ");
+            read_line(kbuf, sizeof(kbuf));
+            int k = atoi(kbuf);
+            if (k < 1) { printf("k inválido.\n"); continue; }
+            printf("Métrica (1 = amigos em comum, 2 = Adamic-Adar): ");
+            read_line(mbuf, sizeof(mbuf));
+            int metric = atoi(mbuf) == 2 ? RECOMMEND_ADAMIC_ADAR : RECOMMEND_MUTUAL;
+            RecommendCtx ctx;
+            recommend_ctx_init(&ctx);
+            Recommendation *out = malloc(sizeof(Recommendation) * (size_t)k);
+            int found = out ? recommend_friends_ctx(&g, &ctx, idx, k, metric, out) : -1;
+            if (found < 0) printf("Erro: sem memória.\n");
+            else {
+                printf("Sugestões para %s:\n", name);
+                if (found == 0) printf("(nenhuma)\n");
+                for (int i = 0; i < found; ++i)
+                    printf(" %d: %s (%d amigo(s) em comum, pontuação %.3f)\n",
+                           out[i].v, vertex_name(&g, out[i].v), out[i].mutual, out[i].score);
+            }
+            free(out);
+            recommend_ctx_free(&ctx);
+        }
+        else if (option == 20) {
+            stats_report();
+            stats_reset();
+        }
+        else if (option == 21) {
+            char kbuf[16];
+            printf("Quantas pessoas (k): ");
+            read_line(kbuf, sizeof(kbuf));
+            int k = atoi(kbuf);
+            if (k < 1) { printf("k inválido.\n"); continue; }
+            int *out = malloc(sizeof(int) * (size_t)k);
+            int *hist = malloc(sizeof(int) * ((size_t)max_degree(&g) + 1));
+            if (!out || !hist) { printf("Erro: sem memória.\n"); free(out); free(hist); continue; }
+            int found = top_degree(&g, k, out);
+            printf("Mais conectadas:\n");
+            if (found == 0) printf("(nenhuma)\n");
+            for (int i = 0; i < found; ++i)
+                printf(" %d: %s (%d amigo(s))\n", out[i], vertex_name(&g, out[i]), vertex_degree(&g, out[i]));
+            int len = degree_histogram(&g, hist, max_degree(&g) + 1);
+            printf("Histograma de graus (grau: pessoas):\n");
+            for (int d = 0; d < len; ++d)
+                if (hist[d] > 0) printf(" %d: %d\n", d, hist[d]);
+            free(out);
+            free(hist);
+        }
+        else if (option == 22) {
+            char mbuf[16];
+            printf("Método (1 = grau, 2 = BFS, 3 = Cuthill-McKee reverso): ");
+            read_line(mbuf, sizeof(mbuf));
+            int method = atoi(mbuf) - 1;
+            if (method < REORDER_DEGREE || method > REORDER_RCM) { printf("Método inválido.\n"); continue; }
+            double before = graph_mean_gap(&g);
+            if (graph_reorder(&g, method) != 0) printf("Erro: sem memória.\n");
+            else printf("Vértices reordenados (distância média entre vizinhos: %.1f -> %.1f).\n",
+                        before, graph_mean_gap(&g));
+        }
+        else if (option == 23) {
+            char a[NAME_LEN], b[NAME_LEN], wbuf[32];
+            printf("Nome da pessoa 1: ");
+            read_line(a, NAME_LEN);
+            printf("Nome da pessoa 2: ");
+            read_line(b, NAME_LEN);
+            printf("Peso (>= 0): ");
+            read_line(wbuf, sizeof(wbuf));
+            char *end;
+            double w = strtod(wbuf, &end);
+            if (end == wbuf || *end != '\0' || !(w >= 0.0) || w > FLT_MAX) { printf("Peso inválido.\n"); continue; }
+            if (set_edge_weight(&g, a, b, (float)w) == 0) printf("Peso de '%s' - '%s' = %g.\n", a, b, w);
+            else printf("Erro ao definir peso (verifique nomes/existência da amizade).\n");
+        }
+        else if (option == 24) {
+            char a[NAME_LEN], b[NAME_LEN];
+            printf("Nome da pessoa 1: ");
+            read_line(a, NAME_LEN);
+            printf("Nome da pessoa 2: ");
+            read_line(b, NAME_LEN);
+            int *path = malloc(sizeof(int) * (size_t)(g.n > 0 ? g.n : 1));
+            if (!path) { printf("Erro: sem memória.\n"); continue; }
+            double cost;
+            int len = weighted_path(&g, a, b, path, g.n, &cost);
+            if (len == -1) printf("Não há caminho (verifique nomes).\n");
+            else {
+                printf("Menor caminho ponderado (custo %g, %d salto(s)): ", cost, len - 1);
+                for (int i = 0; i < len; ++i) printf("%s%s", vertex_name(&g, path[i]), i + 1 < len ? " -> " : "\n");
+            }
+            free(path);
+        }
         else {
             printf("Opção inválida.\n");
         }